@@ -1,4 +1,4 @@
-QT      += core gui qml quick
+QT      += concurrent core gui network qml quick
 CONFIG  += c++11
 TARGET    = AmoebotSim
 TEMPLATE  = app
@@ -19,20 +19,35 @@ HEADERS += \
     alg/trianglerotate.h \
     core/amoebotparticle.h \
     core/amoebotsystem.h \
+    core/ensemblestatistics.h \
+    core/extentmeasure.h \
     core/localparticle.h \
     core/metric.h \
+    core/metricsfile.h \
     core/node.h \
     core/object.h \
     core/particle.h \
     core/simulator.h \
     core/system.h \
+    core/telemetry.h \
+    core/topologymeasure.h \
     helper/randomnumbergenerator.h \
     main/application.h \
+    script/commandserver.h \
+    script/distributedsweep.h \
+    script/parametersweep.h \
     script/scriptengine.h \
+    script/scriptfile.h \
     script/scriptinterface.h \
     ui/algorithm.h \
+    ui/densityrenderer.h \
+    ui/framerecorder.h \
     ui/glitem.h \
     ui/parameterlistmodel.h \
+    ui/particlerenderer.h \
+    ui/renderbenchmark.h \
+    ui/softwarerenderer.h \
+    ui/telemetryviewer.h \
     ui/view.h \
     ui/visitem.h \
     alg/leaderelection.h
@@ -48,20 +63,35 @@ SOURCES += \
     alg/trianglerotate.cpp \
     core/amoebotparticle.cpp \
     core/amoebotsystem.cpp \
+    core/ensemblestatistics.cpp \
+    core/extentmeasure.cpp \
     core/localparticle.cpp \
     core/metric.cpp \
+    core/metricsfile.cpp \
     core/object.cpp \
     core/particle.cpp \
     core/simulator.cpp \
     core/system.cpp \
+    core/telemetry.cpp \
+    core/topologymeasure.cpp \
     helper/randomnumbergenerator.cpp \
     main/application.cpp \
     main/main.cpp\
+    script/commandserver.cpp \
+    script/distributedsweep.cpp \
+    script/parametersweep.cpp \
     script/scriptengine.cpp \
+    script/scriptfile.cpp \
     script/scriptinterface.cpp \
     ui/algorithm.cpp \
+    ui/densityrenderer.cpp \
+    ui/framerecorder.cpp \
     ui/glitem.cpp \
     ui/parameterlistmodel.cpp \
+    ui/particlerenderer.cpp \
+    ui/renderbenchmark.cpp \
+    ui/softwarerenderer.cpp \
+    ui/telemetryviewer.cpp \
     ui/view.cpp \
     ui/visitem.cpp \
     alg/leaderelection.cpp
@@ -10,6 +10,8 @@
 
 #include <QtGlobal>
 
+#include "core/topologymeasure.h"
+
 CompressionParticle::CompressionParticle(const Node head,
                                          const int globalTailDir,
                                          const int orientation,
@@ -258,6 +260,7 @@ CompressionSystem::CompressionSystem(int numParticles, double lambda) {
 
   // Set up metrics.
   _measures.push_back(new PerimeterMeasure("Perimeter", 1, *this));
+  _measures.push_back(new HoleCountMeasure("# Holes", 1, *this));
 }
 
 bool CompressionSystem::hasTerminated() const {
@@ -272,21 +275,56 @@ bool CompressionSystem::hasTerminated() const {
 
 PerimeterMeasure::PerimeterMeasure(const QString name, const unsigned int freq,
                                    CompressionSystem& system)
-    : Measure(name, freq),
-      _system(system) {}
+    : IncrementalMeasure(name, freq),
+      _system(system),
+      _numNbrPairs(0) {}
 
 double PerimeterMeasure::calculate() const {
+  return (3 * _system.size()) - _numNbrPairs - 3;
+}
+
+void PerimeterMeasure::initialize() {
   int numEdges = 0;
   for (const auto& p : _system.particles) {
-    auto comp_p = dynamic_cast<CompressionParticle*>(p);
-    auto tailLabels = comp_p->isContracted() ? comp_p->uniqueLabels()
-                                             : comp_p->tailLabels();
-    for (const int label : tailLabels) {
-      if (comp_p->hasNbrAtLabel(label) && !comp_p->hasExpHeadAtLabel(label)) {
-        ++numEdges;
-      }
+    numEdges += numAnchorNbrs(anchor(p->head, p->globalTailDir), *p);
+  }
+  _numNbrPairs = numEdges / 2;
+}
+
+void PerimeterMeasure::particleMoved(const AmoebotParticle& particle,
+                                     const Node& oldHead,
+                                     int oldGlobalTailDir) {
+  // Every movement primitive changes the anchor of at most one particle (only
+  // contracting an expanded particle's tail does), so the pairs lost at the old
+  // anchor and gained at the new one can be counted in the new configuration.
+  const Node oldAnchor = anchor(oldHead, oldGlobalTailDir);
+  const Node newAnchor = anchor(particle.head, particle.globalTailDir);
+  if (oldAnchor != newAnchor) {
+    _numNbrPairs += numAnchorNbrs(newAnchor, particle)
+                    - numAnchorNbrs(oldAnchor, particle);
+  }
+}
+
+void PerimeterMeasure::particleInserted(const AmoebotParticle& particle) {
+  _numNbrPairs += numAnchorNbrs(anchor(particle.head, particle.globalTailDir),
+                                particle);
+}
+
+Node PerimeterMeasure::anchor(const Node& head, int globalTailDir) {
+  return (globalTailDir == -1) ? head : head.nodeInDir(globalTailDir);
+}
+
+int PerimeterMeasure::numAnchorNbrs(const Node& node,
+                                    const AmoebotParticle& particle) const {
+  int numNbrs = 0;
+  for (int dir = 0; dir < 6; ++dir) {
+    const Node nbrNode = node.nodeInDir(dir);
+    auto it = _system.particleMap.find(nbrNode);
+    if (it != _system.particleMap.end() && it->second != &particle
+        && anchor(it->second->head, it->second->globalTailDir) == nbrNode) {
+      ++numNbrs;
     }
   }
 
-  return (3 * _system.size()) - (numEdges / 2) - 3;
+  return numNbrs;
 }
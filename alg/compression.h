@@ -18,7 +18,6 @@
 
 class CompressionParticle : public AmoebotParticle {
   friend class CompressionSystem;
-  friend class PerimeterMeasure;
 
  public:
   // Constructs a new particle with a node position for its head, a global
@@ -77,20 +76,37 @@ class CompressionSystem : public AmoebotSystem {
   virtual bool hasTerminated() const;
 };
 
-class PerimeterMeasure : public Measure {
+class PerimeterMeasure : public IncrementalMeasure {
  public:
   // Constructs a PerimeterMeasure by using the parent constructor and adding a
   // reference to the CompressionSystem being measured.
   PerimeterMeasure(const QString name, const unsigned int freq,
                    CompressionSystem& system);
 
-  // Calculates the perimeter of the system, i.e., the number of edges on the
-  // walk around the unique external boundary of the system. Uses the fact
-  // that perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3.
+  // Returns the perimeter of the system, i.e., the number of edges on the walk
+  // around the unique external boundary of the system. Uses the fact that
+  // perimeter = (3 * #particles) - (#nearest neighbor pairs) - 3, where the
+  // nearest neighbor pairs are maintained incrementally as particles move.
   double calculate() const final;
 
+  // Counts the nearest neighbor pairs from scratch, and updates them when a
+  // particle is inserted or moves.
+  void initialize() final;
+  void particleMoved(const AmoebotParticle& particle, const Node& oldHead,
+                     int oldGlobalTailDir) final;
+  void particleInserted(const AmoebotParticle& particle) final;
+
  protected:
+  // Returns the node that represents the given particle in the nearest
+  // neighbor pairs: its tail if it is expanded and its head otherwise.
+  static Node anchor(const Node& head, int globalTailDir);
+
+  // Returns the number of particles other than the given one whose anchor is
+  // adjacent to the given node.
+  int numAnchorNbrs(const Node& node, const AmoebotParticle& particle) const;
+
   CompressionSystem& _system;
+  int _numNbrPairs;
 };
 
 #endif  // AMOEBOTSIM_ALG_COMPRESSION_H_
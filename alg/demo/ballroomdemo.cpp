@@ -114,6 +114,10 @@ QString BallroomDemoParticle::inspectionText() const {
   return text;
 }
 
+int BallroomDemoParticle::stateIndex() const {
+  return static_cast<int>(_state);
+}
+
 BallroomDemoParticle& BallroomDemoParticle::nbrAtLabel(int label) const {
   return AmoebotParticle::nbrAtLabel<BallroomDemoParticle>(label);
 }
@@ -81,6 +81,10 @@ QString DiscoDemoParticle::inspectionText() const {
   return text;
 }
 
+int DiscoDemoParticle::stateIndex() const {
+  return static_cast<int>(_state);
+}
+
 DiscoDemoParticle::State DiscoDemoParticle::getRandColor() const {
   // Randomly select an integer and return the corresponding state via casting.
   return static_cast<State>(randInt(0, 7));
@@ -51,6 +51,10 @@ class DiscoDemoParticle : public AmoebotParticle {
   // snapshot the current values of this particle's memory at runtime.
   QString inspectionText() const override;
 
+  // Returns the index of the particle's state in State, for analysis by
+  // scripts.
+  int stateIndex() const override;
+
  protected:
   // Returns a random State.
   State getRandColor() const;
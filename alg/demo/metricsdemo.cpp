@@ -4,8 +4,7 @@
 
 #include "alg/demo/metricsdemo.h"
 
-#include <algorithm>  // for std::max
-#include <cmath>      // for std::sqrt, std::pow
+#include <cmath>  // for std::round, std::sqrt
 
 MetricsDemoParticle::MetricsDemoParticle(const Node& head,
                                          const int globalTailDir,
@@ -25,6 +24,7 @@ void MetricsDemoParticle::activate() {
   if (_counter == 0) {
     _counter = _counterMax;
     _state = getRandColor();
+    system.registerStateChange(this);
   }
 
   // Next, handle movement. If the particle is contracted, choose a random
@@ -87,6 +87,10 @@ QString MetricsDemoParticle::inspectionText() const {
   return text;
 }
 
+int MetricsDemoParticle::stateIndex() const {
+  return static_cast<int>(_state);
+}
+
 MetricsDemoParticle::State MetricsDemoParticle::getRandColor() const {
   // Randomly select an integer and return the corresponding state via casting.
   return static_cast<State>(randInt(0, 7));
@@ -132,42 +136,40 @@ MetricsDemoSystem::MetricsDemoSystem(unsigned int numParticles, int counterMax)
 PercentRedMeasure::PercentRedMeasure(const QString name,
                                      const unsigned int freq,
                                      MetricsDemoSystem& system)
-    : Measure(name, freq),
+    : IncrementalMeasure(name, freq),
       _system(system) {}
 
 double PercentRedMeasure::calculate() const {
-  int numRed = 0;
+  return _redParticles.size() / static_cast<double>(_system.size()) * 100;
+}
 
-  // Loop through all particles of the system.
+void PercentRedMeasure::initialize() {
+  _redParticles.clear();
   for (const auto& p : _system.particles) {
-    // Convert the pointer to a MetricsDemoParticle so its color can be checked.
-    auto metr_p = dynamic_cast<MetricsDemoParticle*>(p);
-    if (metr_p->_state == MetricsDemoParticle::State::Red) {
-      numRed++;
-    }
+    update(*p);
   }
+}
 
-  return numRed / static_cast<double>(_system.size()) * 100;
+void PercentRedMeasure::particleInserted(const AmoebotParticle& particle) {
+  update(particle);
 }
 
-MaxDistanceMeasure::MaxDistanceMeasure(const QString name,
-                                       const unsigned int freq,
-                                       MetricsDemoSystem& system)
-    : Measure(name, freq),
-      _system(system) {}
+void PercentRedMeasure::stateChanged(const AmoebotParticle& particle) {
+  update(particle);
+}
 
-double MaxDistanceMeasure::calculate() const {
-  double maxDist = 0.0;
-  for (const auto& p1 : _system.particles) {
-    double x1 = p1->head.x + p1->head.y / 2.0;
-    double y1 = std::sqrt(3.0) / 2 * p1->head.y;
-    for (const auto& p2 : _system.particles) {
-      double x2 = p2->head.x + p2->head.y / 2.0;
-      double y2 = std::sqrt(3.0) / 2 * p2->head.y;
-      maxDist = std::max(std::sqrt(std::pow(x2 - x1, 2) + std::pow(y2 - y1, 2)),
-                         maxDist);
-    }
+void PercentRedMeasure::update(const AmoebotParticle& particle) {
+  // All particles of a MetricsDemoSystem are MetricsDemoParticles, so the cast
+  // needed to check the particle's color can be a static one.
+  auto& metr_p = static_cast<const MetricsDemoParticle&>(particle);
+  if (metr_p._state == MetricsDemoParticle::State::Red) {
+    _redParticles.insert(&particle);
+  } else {
+    _redParticles.erase(&particle);
   }
-
-  return maxDist;
 }
+
+MaxDistanceMeasure::MaxDistanceMeasure(const QString name,
+                                       const unsigned int freq,
+                                       MetricsDemoSystem& system)
+    : DiameterMeasure(name, freq, system, Tracked::Heads) {}
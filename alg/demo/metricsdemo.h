@@ -11,10 +11,13 @@
 #ifndef AMOEBOTSIM_ALG_DEMO_METRICSDEMO_H_
 #define AMOEBOTSIM_ALG_DEMO_METRICSDEMO_H_
 
+#include <unordered_set>
+
 #include <QString>
 
 #include "core/amoebotparticle.h"
 #include "core/amoebotsystem.h"
+#include "core/extentmeasure.h"
 
 class MetricsDemoParticle : public AmoebotParticle {
   friend class PercentRedMeasure;
@@ -52,6 +55,10 @@ class MetricsDemoParticle : public AmoebotParticle {
   // snapshot the current values of this particle's memory at runtime.
   QString inspectionText() const override;
 
+  // Returns the index of the particle's state in State, for analysis by
+  // scripts.
+  int stateIndex() const override;
+
  protected:
   // Returns a random State.
   State getRandColor() const;
@@ -67,7 +74,6 @@ class MetricsDemoParticle : public AmoebotParticle {
 
 class MetricsDemoSystem : public AmoebotSystem {
   friend class PercentRedMeasure;
-  friend class MaxDistanceMeasure;
 
  public:
   // Constructs a system of the specified number of MetricsDemoParticles
@@ -75,33 +81,38 @@ class MetricsDemoSystem : public AmoebotSystem {
   MetricsDemoSystem(unsigned int numParticles = 30, int counterMax = 5);
 };
 
-class PercentRedMeasure : public Measure {
+class PercentRedMeasure : public IncrementalMeasure {
  public:
   // Constructs a PercentRedMeasure by using the parent constructor and adding a
   // reference to the MetricsDemoSystem being measured.
   PercentRedMeasure(const QString name, const unsigned int freq,
                     MetricsDemoSystem& system);
 
-  // Calculated the percentage of particles in the system in the Red state.
+  // Returns the percentage of particles in the system in the Red state.
   double calculate() const final;
 
+  // Collects the red particles from scratch, and updates them whenever a
+  // particle is inserted or changes its state.
+  void initialize() final;
+  void particleInserted(const AmoebotParticle& particle) final;
+  void stateChanged(const AmoebotParticle& particle) final;
+
  protected:
+  // Adds the given particle to or removes it from the red particles, according
+  // to its current state.
+  void update(const AmoebotParticle& particle);
+
   MetricsDemoSystem& _system;
+  std::unordered_set<const AmoebotParticle*> _redParticles;
 };
 
-class MaxDistanceMeasure : public Measure {
+class MaxDistanceMeasure : public DiameterMeasure {
  public:
-  // Constructs a MaxDistanceMeasure by using the parent constructor and adding
-  // a reference to the MetricsDemoSystem being measured.
+  // Constructs a MaxDistanceMeasure, i.e., a DiameterMeasure on the heads of
+  // the MetricsDemoSystem's particles. It measures the largest Cartesian
+  // distance between any pair of particles in the system.
   MaxDistanceMeasure(const QString name, const unsigned int freq,
                      MetricsDemoSystem& system);
-
-  // Calculates the largest Cartesian distance between any pair of particles in
-  // the system.
-  double calculate() const final;
-
- protected:
-  MetricsDemoSystem& _system;
 };
 
 #endif  // AMOEBOTSIM_ALG_DEMO_METRICSDEMO_H_
@@ -138,6 +138,10 @@ QString InfObjCoatingParticle::inspectionText() const {
   return text;
 }
 
+int InfObjCoatingParticle::stateIndex() const {
+  return static_cast<int>(state);
+}
+
 InfObjCoatingParticle& InfObjCoatingParticle::nbrAtLabel(int label) const {
   return AmoebotParticle::nbrAtLabel<InfObjCoatingParticle>(label);
 }
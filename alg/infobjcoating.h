@@ -48,6 +48,10 @@ class InfObjCoatingParticle : public AmoebotParticle {
   // to snapshot the current values of this particle's memory at runtime.
   QString inspectionText() const override;
 
+  // Returns the index of the particle's state in State, for analysis by
+  // scripts.
+  int stateIndex() const override;
+
   // Gets a reference to the neighboring particle incident to the specified port
   // label. Crashes if no such particle exists at this label; consider using
   // hasNbrAtLabel() first if unsure.
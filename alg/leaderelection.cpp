@@ -17,10 +17,7 @@ LeaderElectionParticle::LeaderElectionParticle(const Node head,
                                                State state)
   : AmoebotParticle(head, globalTailDir, orientation, system),
     state(state),
-    currentAgent(0) {
-  borderColorLabels.fill(-1);
-  borderPointColorLabels.fill(-1);
-}
+    currentAgent(0) {}
 
 void LeaderElectionParticle::activate() {
   if (state == State::Idle) {
@@ -51,7 +48,6 @@ void LeaderElectionParticle::activate() {
           agent->prevAgentDir = getPrevAgentDir(dir);
           agent->agentState = State::Candidate;
           agent->subPhase = LeaderElectionAgent::SubPhase::SegmentComparison;
-          agent->setStateColor();
 
           agent->paintBackSegment(0x696969);
           agent->paintFrontSegment(0x696969);
@@ -167,12 +163,29 @@ QString LeaderElectionParticle::inspectionText() const {
   return text;
 }
 
+int LeaderElectionParticle::stateIndex() const {
+  return static_cast<int>(state);
+}
+
 std::array<int, 18> LeaderElectionParticle::borderColors() const {
-  return borderColorLabels;
+  std::array<int, 18> borderColors;
+  borderColors.fill(-1);
+  for (const LeaderElectionAgent* agent : agents) {
+    agent->drawBorders(borderColors);
+  }
+
+  return borderColors;
 }
 
 std::array<int, 6> LeaderElectionParticle::borderPointColors() const {
-  return borderPointColorLabels;
+  std::array<int, 6> borderPointColors;
+  borderPointColors.fill(-1);
+  for (const LeaderElectionAgent* agent : agents) {
+    borderPointColors.at(localToGlobalDir(agent->agentDir)) =
+        agent->stateColor();
+  }
+
+  return borderPointColors;
 }
 
 LeaderElectionParticle& LeaderElectionParticle::nbrAtLabel(int label) const {
@@ -275,7 +288,6 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
           absorbedActiveToken = true;
           isCoveredCandidate = true;
           agentState = State::Demoted;
-          setStateColor();
           return;
         }
       } else {
@@ -352,10 +364,8 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
             hasCoveredCandidate;
         if (!coveredCandidateCheck && !gotAnnounceInCompare) {
           agentState = State::Demoted;
-          setStateColor();
         } else {
           subPhase = SubPhase::CoinFlipping;
-          setStateColor();
         }
         comparingSegment = false;
         gotAnnounceInCompare = false;
@@ -375,7 +385,6 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
         } else {
           subPhase = SubPhase::SolitudeVerification;
         }
-        setStateColor();
         waitingForTransferAck = false;
         gotAnnounceBeforeAck = false;
         return;
@@ -415,7 +424,6 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
         takeAgentToken<SolitudeActiveToken>(nextAgentDir);
         createdLead = false;
         cleanSolitudeVerificationTokens();
-        setStateColor();
         return;
       }
     }
@@ -632,7 +640,6 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
       paintBackSegment(-1);
       paintFrontSegment(-1);
       agentState = State::Finished;
-      setStateColor();
     }
 
   } else if (agentState == State::SoleCandidate) {
@@ -653,7 +660,6 @@ void LeaderElectionParticle::LeaderElectionAgent::activate() {
       } else {
         Q_ASSERT(false);
       }
-      setStateColor();
       testingBorder = false;
       return;
     }
@@ -954,49 +960,45 @@ LeaderElectionParticle::LeaderElectionAgent::prevAgent() const {
   return nullptr;
 }
 
-void LeaderElectionParticle::LeaderElectionAgent::setStateColor() {
-  int globalizedDir = candidateParticle->localToGlobalDir(agentDir);
+int LeaderElectionParticle::LeaderElectionAgent::stateColor() const {
   switch (agentState) {
     case State::Candidate:
-      setSubPhaseColor();
-      break;
+      return subPhaseColor();
     case State::Demoted:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = 0x696969;
-      break;
+      return 0x696969;
     case State::SoleCandidate:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = 0x00ff00;
-      break;
-    case State::Leader:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = -1;
-      break;
-    case State::Finished:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = -1;
-      break;
+      return 0x00ff00;
     default:
-      break;
+      return -1;
   }
 }
 
-void LeaderElectionParticle::LeaderElectionAgent::setSubPhaseColor() {
-  int globalizedDir = candidateParticle->localToGlobalDir(agentDir);
+int LeaderElectionParticle::LeaderElectionAgent::subPhaseColor() const {
   switch (subPhase) {
     case SubPhase::SegmentComparison:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = 0xff0000;
-      break;
+      return 0xff0000;
     case SubPhase::CoinFlipping:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = 0xffa500;
-      break;
+      return 0xffa500;
     case SubPhase::SolitudeVerification:
-      candidateParticle->borderPointColorLabels.at(globalizedDir) = 0x00bfff;
-      break;
+      return 0x00bfff;
     default:
       Q_ASSERT(false);
-      break;
+      return -1;
   }
 }
 
 void LeaderElectionParticle::LeaderElectionAgent::paintFrontSegment(
     const int color) {
+  frontSegmentColor = color;
+}
+
+void LeaderElectionParticle::LeaderElectionAgent::paintBackSegment(
+    const int color) {
+  backSegmentColor = color;
+}
+
+void LeaderElectionParticle::LeaderElectionAgent::drawBorders(
+    std::array<int, 18>& borderColors) const {
   // Must use localToGlobalDir method to reconcile the difference between the
   // local orientation of the particle and the global orientation used by
   // drawing
@@ -1004,20 +1006,12 @@ void LeaderElectionParticle::LeaderElectionAgent::paintFrontSegment(
   int tempNextDir = candidateParticle->localToGlobalDir(nextAgentDir);
   while (tempDir != (tempNextDir + 1) % 6) {
       if ((tempDir + 5) % 6 != tempNextDir) {
-          candidateParticle->borderColorLabels.at((3 * tempDir + 17) % 18) =
-              color;
+          borderColors.at((3 * tempDir + 17) % 18) = frontSegmentColor;
       }
       tempDir = (tempDir + 5) % 6;
   }
-}
-
-void LeaderElectionParticle::LeaderElectionAgent::paintBackSegment(
-    const int color) {
-  // Must use localToGlobalDir method to reconcile the difference between the
-  // local orientation of the particle and the global orientation used by
-  // drawing
-  candidateParticle->borderColorLabels.at(
-        3 * candidateParticle->localToGlobalDir(agentDir) + 1) = color;
+  borderColors.at(3 * candidateParticle->localToGlobalDir(agentDir) + 1) =
+      backSegmentColor;
 }
 
 //----------------------------END AGENT CODE----------------------------
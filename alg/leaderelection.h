@@ -68,8 +68,13 @@ class LeaderElectionParticle : public AmoebotParticle {
   // to snapshot the current values of this particle's memory at runtime.
   virtual QString inspectionText() const;
 
+  // Returns the index of the particle's state in State, for analysis by
+  // scripts.
+  virtual int stateIndex() const;
+
   // Returns the borderColors and borderPointColors arrays associated with the
-  // particle to draw the boundaries for leader election.
+  // particle to draw the boundaries for leader election. They are computed
+  // from the particle's agents on demand instead of being stored.
   virtual std::array<int, 18> borderColors() const;
   virtual std::array<int, 6> borderPointColors() const;
 
@@ -345,18 +350,22 @@ class LeaderElectionParticle : public AmoebotParticle {
     LeaderElectionAgent* prevAgent() const;
 
     // Methods responsible for rendering the agents onto the simulator with
-    // their colors changing based on the state and the subphase of the current
-    // agent
+    // their colors depending on the state and the subphase of the current
+    // agent. The colors are computed from the agent's state only when a frame
+    // is drawn, so activations never touch them.
     // Red --> Candidate agent in Segment Comparison Subphase
     // Yellow --> Candidate agent in Coin Flipping Subphase
     // Blue --> Candidate agent in Solitude Verification Subphase
     // Grey --> Demoted agent
     // Green --> Sole candidate
-    void setStateColor();
-    void setSubPhaseColor();
+    int stateColor() const;
+    int subPhaseColor() const;
 
     // Methods responsible for painting the borders which will act as physical
-    // representations of the cycle for leader election
+    // representations of the cycle for leader election. paintFrontSegment and
+    // paintBackSegment only record the color of the agent's front and back
+    // segments; drawBorders writes them into a particle's border color array
+    // when a frame is drawn.
     // Red --> Segment Comparison Phase
     // Yellow --> Coin Flipping Phase
     // Blue --> Solitude Verification Phase
@@ -364,14 +373,17 @@ class LeaderElectionParticle : public AmoebotParticle {
     // phase
     void paintFrontSegment(const int color);
     void paintBackSegment(const int color);
+    void drawBorders(std::array<int, 18>& borderColors) const;
+
+    // The colors of this agent's front and back segments (-1 if not drawn).
+    int frontSegmentColor = -1;
+    int backSegmentColor = -1;
   };
 
   protected:
    State state;
    unsigned int currentAgent;
    std::vector<LeaderElectionAgent*> agents;
-   std::array<int, 18> borderColorLabels;
-   std::array<int, 6> borderPointColorLabels;
 };
 
 class LeaderElectionSystem : public AmoebotSystem {
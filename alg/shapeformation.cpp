@@ -152,6 +152,10 @@ QString ShapeFormationParticle::inspectionText() const {
   return text;
 }
 
+int ShapeFormationParticle::stateIndex() const {
+  return static_cast<int>(state);
+}
+
 ShapeFormationParticle& ShapeFormationParticle::nbrAtLabel(int label) const {
   return AmoebotParticle::nbrAtLabel<ShapeFormationParticle>(label);
 }
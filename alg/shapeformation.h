@@ -57,6 +57,10 @@ class ShapeFormationParticle : public AmoebotParticle {
   // to snapshot the current values of this particle's memory at runtime.
   virtual QString inspectionText() const;
 
+  // Returns the index of the particle's state in State, for analysis by
+  // scripts.
+  virtual int stateIndex() const;
+
   // Gets a reference to the neighboring particle incident to the specified port
   // label. Crashes if no such particle exists at this label; consider using
   // hasNbrAtLabel() first if unsure.
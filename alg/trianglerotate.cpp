@@ -516,6 +516,10 @@ QString TriangleRotateParticle::inspectionText() const {
     return text;
 }
 
+int TriangleRotateParticle::stateIndex() const {
+    return static_cast<int>(state);
+}
+
 
 TriangleRotateSystem::TriangleRotateSystem(int sideLength, bool setCenter) {
     Q_ASSERT(sideLength % 3 == 1); // Should be a "perfect" triangle
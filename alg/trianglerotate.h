@@ -56,6 +56,10 @@ public:
     // to snapshot the current values of this particle's memory at runtime.
     virtual QString inspectionText() const;
 
+    // Returns the index of the particle's state in State, for analysis by
+    // scripts.
+    virtual int stateIndex() const;
+
     // Checks if this particle has exactly 2 neighboring particles adjacent to each other
     std::vector<int> isCorner();
 
@@ -43,10 +43,13 @@ void AmoebotParticle::expand(int label) {
   Q_ASSERT(canExpand(label));
 
   const int globalExpansionDir = localToGlobalDir(label);
+  const Node oldHead = head;
   head = head.nodeInDir(globalExpansionDir);
   globalTailDir = (globalExpansionDir + 3) % 6;
   system.particleMap[head] = this;
 
+  system.registerNodeOccupied(head);
+  system.registerParticleMoved(this, oldHead, -1);
   system.registerMovement();
 }
 
@@ -63,6 +66,9 @@ void AmoebotParticle::push(int label) {
   const int globalExpansionDir = localToGlobalDir(label);
   const Node handoverNode = head.nodeInDir(globalExpansionDir);
   auto& neighbor = nbrAtLabel<AmoebotParticle>(label);
+  const Node oldHead = head;
+  const Node nbrOldHead = neighbor.head;
+  const int nbrOldTailDir = neighbor.globalTailDir;
 
   head = handoverNode;
   globalTailDir = (globalExpansionDir + 3) % 6;
@@ -73,6 +79,8 @@ void AmoebotParticle::push(int label) {
   }
   neighbor.globalTailDir = -1;
 
+  system.registerParticleMoved(this, oldHead, -1);
+  system.registerParticleMoved(&neighbor, nbrOldHead, nbrOldTailDir);
   system.registerMovement(2);
   system.registerActivation(&neighbor);
 }
@@ -87,19 +95,27 @@ void AmoebotParticle::contract(int label) {
 void AmoebotParticle::contractHead() {
   Q_ASSERT(isExpanded());
 
+  const Node oldHead = head;
+  const int oldTailDir = globalTailDir;
   system.particleMap.erase(head);
   head = tail();
   globalTailDir = -1;
 
+  system.registerNodeVacated(oldHead);
+  system.registerParticleMoved(this, oldHead, oldTailDir);
   system.registerMovement();
 }
 
 void AmoebotParticle::contractTail() {
   Q_ASSERT(isExpanded());
 
-  system.particleMap.erase(tail());
+  const Node oldTail = tail();
+  const int oldTailDir = globalTailDir;
+  system.particleMap.erase(oldTail);
   globalTailDir = -1;
 
+  system.registerNodeVacated(oldTail);
+  system.registerParticleMoved(this, head, oldTailDir);
   system.registerMovement();
 }
 
@@ -116,6 +132,9 @@ void AmoebotParticle::pull(int label) {
   const int globalPullDir = labelToGlobalDir(label);
   const Node handoverNode = isHeadLabel(label) ? head : tail();
   auto& neighbor = nbrAtLabel<AmoebotParticle>(label);
+  const Node oldHead = head;
+  const int oldTailDir = globalTailDir;
+  const Node nbrOldHead = neighbor.head;
 
   if (isHeadLabel(label)) {
     head = tail();
@@ -126,6 +145,8 @@ void AmoebotParticle::pull(int label) {
   neighbor.globalTailDir = globalPullDir;
   system.particleMap[handoverNode] = &neighbor;
 
+  system.registerParticleMoved(this, oldHead, oldTailDir);
+  system.registerParticleMoved(&neighbor, nbrOldHead, -1);
   system.registerMovement(2);
   system.registerActivation(&neighbor);
 }
@@ -4,12 +4,17 @@
 
 #include "core/amoebotsystem.h"
 
+#include <algorithm>
+#include <functional>
+
 #include <QDateTime>
 #include <QtGlobal>
 
 #include "core/amoebotparticle.h"
+#include "core/metricsfile.h"
 
-AmoebotSystem::AmoebotSystem() {
+AmoebotSystem::AmoebotSystem()
+  : _numSyncedMeasures(0) {
   _counts.push_back(new Count("# Rounds"));
   _counts.push_back(new Count("# Activations"));
   _counts.push_back(new Count("# Moves"));
@@ -36,16 +41,24 @@ AmoebotSystem::~AmoebotSystem() {
 }
 
 void AmoebotSystem::activate() {
+  syncIncrementalMeasures();
   int rand = randInt(0, particles.size());
-  particles.at(rand)->activate();
-  registerActivation(particles.at(rand));
+  AmoebotParticle* particle = particles.at(rand);
+  journalNeighborhood(particle);
+  particle->activate();
+  journalNeighborhood(particle);
+  registerActivation(particle);
 }
 
 void AmoebotSystem::activateParticleAt(Node node) {
+  syncIncrementalMeasures();
   auto it = particleMap.find(node);
   if (it != particleMap.end()) {
-    it->second->activate();
-    registerActivation(it->second);
+    AmoebotParticle* particle = it->second;
+    journalNeighborhood(particle);
+    particle->activate();
+    journalNeighborhood(particle);
+    registerActivation(particle);
   }
 }
 
@@ -65,17 +78,80 @@ const std::deque<Object*>& AmoebotSystem::getObjects() const {
   return objects;
 }
 
+bool AmoebotSystem::isOccupied(const Node& node) const {
+  return particleMap.find(node) != particleMap.end();
+}
+
+const Particle* AmoebotSystem::particleAt(const Node& node) const {
+  auto it = particleMap.find(node);
+  return (it != particleMap.end()) ? it->second : nullptr;
+}
+
+void AmoebotSystem::particlesInRange(
+    int xMin, int xMax, int yMin, int yMax,
+    std::vector<const Particle*>& result) const {
+  if (xMin > xMax || yMin > yMax) {
+    return;
+  }
+
+  auto collect = [&](const std::vector<AmoebotParticle*>& tile) {
+    for (const AmoebotParticle* p : tile) {
+      if (xMin <= p->head.x && p->head.x <= xMax
+          && yMin <= p->head.y && p->head.y <= yMax) {
+        result.push_back(p);
+      }
+    }
+  };
+
+  const int tileXMin = xMin >> tileShift, tileXMax = xMax >> tileShift;
+  const int tileYMin = yMin >> tileShift, tileYMax = yMax >> tileShift;
+  const qint64 numTilesInRange =
+      (static_cast<qint64>(tileXMax) - tileXMin + 1)
+      * (static_cast<qint64>(tileYMax) - tileYMin + 1);
+  if (numTilesInRange > static_cast<qint64>(tiles.size())) {
+    for (const auto& tile : tiles) {
+      collect(tile.second);
+    }
+  } else {
+    for (int tileY = tileYMin; tileY <= tileYMax; ++tileY) {
+      for (int tileX = tileXMin; tileX <= tileXMax; ++tileX) {
+        auto it = tiles.find(tileKey(tileX, tileY));
+        if (it != tiles.end()) {
+          collect(it->second);
+        }
+      }
+    }
+  }
+}
+
+QPointF AmoebotSystem::centerOfMass() const {
+  return QPointF(occupiedNodes.centroidX(), occupiedNodes.centroidY());
+}
+
+QRectF AmoebotSystem::boundingBox() const {
+  return QRectF(QPointF(occupiedNodes.left(), occupiedNodes.bottom()),
+                QPointF(occupiedNodes.right(), occupiedNodes.top()));
+}
+
 void AmoebotSystem::insert(AmoebotParticle* particle) {
   Q_ASSERT(particleMap.find(particle->head) == particleMap.end());
   Q_ASSERT(objectMap.find(particle->head) == objectMap.end());
   Q_ASSERT(!particle->isExpanded() ||
            particleMap.find(particle->tail()) == particleMap.end());
 
+  syncIncrementalMeasures();
   particles.push_back(particle);
+  addToTile(tileKey(particle->head), particle);
   particleMap[particle->head] = particle;
+  registerNodeOccupied(particle->head);
   if (particle->isExpanded()) {
     particleMap[particle->tail()] = particle;
+    registerNodeOccupied(particle->tail());
+  }
+  for (auto m : _incrementalMeasures) {
+    m->particleInserted(*particle);
   }
+  journalReset();
 }
 
 void AmoebotSystem::insert(Object* object) {
@@ -84,6 +160,8 @@ void AmoebotSystem::insert(Object* object) {
 
   objects.push_back(object);
   objectMap[object->_node] = object;
+  occupiedNodes.insert(object->_node);
+  journalReset();
 }
 
 void AmoebotSystem::registerMovement(unsigned int numMoves) {
@@ -99,18 +177,78 @@ void AmoebotSystem::registerActivation(AmoebotParticle* particle) {
   }
 }
 
+void AmoebotSystem::registerNodeOccupied(const Node& node) {
+  occupiedNodes.insert(node);
+  for (auto m : _incrementalMeasures) {
+    m->nodeOccupied(node);
+  }
+}
+
+void AmoebotSystem::registerNodeVacated(const Node& node) {
+  occupiedNodes.erase(node);
+  for (auto m : _incrementalMeasures) {
+    m->nodeVacated(node);
+  }
+}
+
+void AmoebotSystem::registerParticleMoved(AmoebotParticle* particle,
+                                          const Node& oldHead,
+                                          int oldGlobalTailDir) {
+  const qint64 oldKey = tileKey(oldHead), newKey = tileKey(particle->head);
+  if (oldKey != newKey) {
+    removeFromTile(oldKey, particle);
+    addToTile(newKey, particle);
+  }
+  for (auto m : _incrementalMeasures) {
+    m->particleMoved(*particle, oldHead, oldGlobalTailDir);
+  }
+  journalChange(particle);
+}
+
+void AmoebotSystem::registerStateChange(AmoebotParticle* particle) {
+  for (auto m : _incrementalMeasures) {
+    m->stateChanged(*particle);
+  }
+  journalChange(particle);
+}
+
 void AmoebotSystem::registerRound() {
+  syncIncrementalMeasures();
+  const quint64 round = getCount("# Rounds")._value;
   for (const auto& c : _counts) {
-    c->_history.push_back(c->_value);
+    c->_history.push(c->_value, round);
   }
   for (const auto& m : _measures) {
-    if (getCount("# Rounds")._value % m->_freq == 0) {
-      m->_history.push_back(m->calculate());
+    if (round % m->_freq == 0) {
+      m->_history.push(m->calculate(), round);
     }
   }
   getCount("# Rounds").record();
 }
 
+void AmoebotSystem::setHistoryPolicy(HistoryPolicy policy,
+                                     unsigned int capacity, double ratio) {
+  for (const auto& c : _counts) {
+    c->_history.setPolicy(policy, capacity, ratio);
+  }
+  for (const auto& m : _measures) {
+    m->_history.setPolicy(policy, capacity, ratio);
+  }
+}
+
+void AmoebotSystem::syncIncrementalMeasures() {
+  // Measures are usually added to _measures directly by system constructors
+  // (after the particles were inserted), so new incremental measures are
+  // discovered lazily here rather than through a dedicated registration call.
+  for (; _numSyncedMeasures < _measures.size(); ++_numSyncedMeasures) {
+    auto m = dynamic_cast<IncrementalMeasure*>(_measures[_numSyncedMeasures]);
+    if (m != nullptr) {
+      m->initialize();
+      _incrementalMeasures.push_back(m);
+    }
+  }
+}
+
 const std::vector<Count*>& AmoebotSystem::getCounts() const {
   return _counts;
 }
@@ -138,6 +276,43 @@ Measure& AmoebotSystem::getMeasure(QString name) const {
 }
 
 
+// Formats the extra fields of a history that does not retain every sample: the
+// round of each retained sample and, for bucketed histories, the aggregates of
+// each bucket.
+template<class T>
+static QString historyDetailsAsJSON(const History<T>& history) {
+  if (history.isComplete()) {
+    return "";
+  }
+
+  auto asList = [&history](std::function<QString(unsigned int)> valueAt) {
+    QString list = "[";
+    for (unsigned int i = 0; i < history.size(); ++i) {
+      list += valueAt(i) + ", ";
+    }
+    if (history.size() > 0) {
+      list.chop(2);  // Remove the last ", ".
+    }
+    return list + "]";
+  };
+
+  QString json = ", \"rounds\" : " + asList([&history](unsigned int i) {
+    return QString::number(history.roundAt(i));
+  });
+  if (history.policy() == HistoryPolicy::Buckets) {
+    json += ", \"min\" : " + asList([&history](unsigned int i) {
+      return QString::number(history.minAt(i));
+    });
+    json += ", \"max\" : " + asList([&history](unsigned int i) {
+      return QString::number(history.maxAt(i));
+    });
+    json += ", \"mean\" : " + asList([&history](unsigned int i) {
+      return QString::number(history.meanAt(i));
+    });
+  }
+  return json;
+}
+
 const QString AmoebotSystem::metricsAsJSON() const {
   QString json = "{\"title\" : \"AmoebotSim Metrics JSON\", ";
   json += "\"datetime\" : \"" +
@@ -150,10 +325,10 @@ const QString AmoebotSystem::metricsAsJSON() const {
     for (auto val : c->_history) {
       json += QString::number(val) += ", ";
     }
-    if (!c->_history.empty()) {
+    if (c->_history.size() > 0) {
       json.chop(2);  // Remove the last ", ".
     }
-    json += "]}, ";
+    json += "]" + historyDetailsAsJSON(c->_history) + "}, ";
   }
   if (!_counts.empty()) {
     json.chop(2);  // Remove the last ", ".
@@ -166,10 +341,10 @@ const QString AmoebotSystem::metricsAsJSON() const {
     for (auto val : m->_history) {
       json += QString::number(val) += ", ";
     }
-    if (!m->_history.empty()) {
+    if (m->_history.size() > 0) {
       json.chop(2);  // Remove the last ", ".
     }
-    json += "]}, ";
+    json += "]" + historyDetailsAsJSON(m->_history) + "}, ";
   }
   if (!_measures.empty()) {
     json.chop(2);  // Remove the last ", ".
@@ -177,3 +352,55 @@ const QString AmoebotSystem::metricsAsJSON() const {
   json += "]}";
   return json;
 }
+
+const QByteArray AmoebotSystem::metricsAsBinary(bool deltaEncode) const {
+  return MetricsFile::serialize(_counts, _measures, deltaEncode);
+}
+
+void AmoebotSystem::journalNeighborhood(AmoebotParticle* particle) {
+  // An activation may change the appearance of the activated particle and of
+  // any particle whose memory it writes to, i.e., of its neighbors.
+  if (isJournalReset()) {
+    return;
+  }
+
+  journalChange(particle);
+  for (int dir = 0; dir < 6; ++dir) {
+    auto it = particleMap.find(particle->head.nodeInDir(dir));
+    if (it != particleMap.end()) {
+      journalChange(it->second);
+    }
+    if (particle->isExpanded()) {
+      it = particleMap.find(particle->tail().nodeInDir(dir));
+      if (it != particleMap.end()) {
+        journalChange(it->second);
+      }
+    }
+  }
+}
+
+qint64 AmoebotSystem::tileKey(int tileX, int tileY) {
+  return (static_cast<quint64>(static_cast<quint32>(tileX)) << 32)
+         | static_cast<quint32>(tileY);
+}
+
+qint64 AmoebotSystem::tileKey(const Node& node) {
+  return tileKey(node.x >> tileShift, node.y >> tileShift);
+}
+
+void AmoebotSystem::addToTile(qint64 key, AmoebotParticle* particle) {
+  tiles[key].push_back(particle);
+}
+
+void AmoebotSystem::removeFromTile(qint64 key, AmoebotParticle* particle) {
+  auto it = tiles.find(key);
+  Q_ASSERT(it != tiles.end());
+  auto& tile = it->second;
+  auto pos = std::find(tile.begin(), tile.end(), particle);
+  Q_ASSERT(pos != tile.end());
+  *pos = tile.back();
+  tile.pop_back();
+  if (tile.empty()) {
+    tiles.erase(it);
+  }
+}
@@ -9,12 +9,15 @@
 #define AMOEBOTSIM_CORE_AMOEBOTSYSTEM_H_
 
 #include <deque>
-#include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
+#include <QByteArray>
 #include <QString>
+#include <QtGlobal>
 
+#include "core/extentmeasure.h"
 #include "core/metric.h"
 #include "core/object.h"
 #include "core/system.h"
@@ -53,6 +56,25 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   // Returns a reference to the object list.
   virtual const std::deque<Object*>& getObjects() const final;
 
+  // Returns true if and only if the given node is occupied by the head or tail
+  // of a particle.
+  bool isOccupied(const Node& node) const;
+
+  // Spatial queries; see system.h. particleAt takes O(1) expected time.
+  // particlesInRange uses an index of the particles' heads by square tiles of
+  // the lattice and takes time linear in the number of tiles overlapping the
+  // range (or in the number of nonempty tiles, if that is smaller) plus the
+  // number of particles in them.
+  const Particle* particleAt(const Node& node) const final;
+  void particlesInRange(int xMin, int xMax, int yMin, int yMax,
+                        std::vector<const Particle*>& result) const final;
+
+  // Aggregates of the occupied nodes; see system.h. These take O(1) time, since
+  // the occupied nodes are kept in a LatticeExtent (see extentmeasure.h) that
+  // is updated as particles and objects are inserted and particles move.
+  QPointF centerOfMass() const final;
+  QRectF boundingBox() const final;
+
   // Inserts a particle or an object, respectively, into the system. A particle
   // can be contracted or expanded. Fails if the respective node(s) are already
   // occupied.
@@ -69,6 +91,24 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   void registerActivation(AmoebotParticle* particle);
   void registerRound();
 
+  // Functions for reporting configuration changes to the system's incremental
+  // measures (see IncrementalMeasure in metric.h) and its aggregates of the
+  // occupied nodes. registerNodeOccupied, registerNodeVacated, and
+  // registerParticleMoved are called by the movement primitives in
+  // AmoebotParticle. registerStateChange should be called by algorithms
+  // whenever a particle changes its state in a way that incremental measures
+  // may depend on.
+  void registerNodeOccupied(const Node& node);
+  void registerNodeVacated(const Node& node);
+  void registerParticleMoved(AmoebotParticle* particle, const Node& oldHead,
+                             int oldGlobalTailDir);
+  void registerStateChange(AmoebotParticle* particle);
+
+  // Sets the retention policy of all count and measure histories; see the
+  // HistoryPolicy documentation in metric.h for the meaning of the parameters.
+  void setHistoryPolicy(HistoryPolicy policy, unsigned int capacity = 0,
+                        double ratio = 2.0) final;
+
   // Various access functions for metrics (counts and measures). getCounts
   // (resp., getMeasures) returns a reference to the count (resp., measure)
   // list. getCount (resp., getMeasure) returns a reference to the named count
@@ -83,14 +123,40 @@ class AmoebotSystem : public System, public RandomNumberGenerator {
   // this JSON string can be found in the Usage documentation.
   const QString metricsAsJSON() const final;
 
+  // Serializes the count and measure histories into the columnar binary format
+  // described in metricsfile.h, optionally delta-encoding the count histories.
+  const QByteArray metricsAsBinary(bool deltaEncode = false) const final;
+
  protected:
+  // Initializes the incremental measures that were added to the measure list
+  // since the last call and starts delivering configuration changes to them.
+  void syncIncrementalMeasures();
+
+  // Records the given particle and its neighbors in the change journal.
+  void journalNeighborhood(AmoebotParticle* particle);
+
+  // Functions for maintaining the tile index of the particles' heads. Tiles are
+  // squares of 2^tileShift by 2^tileShift nodes in lattice coordinates.
+  // tileKey returns the key of the tile with the given tile coordinates (resp.,
+  // containing the given node), and addToTile (resp., removeFromTile) adds
+  // (resp., removes) a particle to (resp., from) the tile with the given key.
+  static constexpr int tileShift = 4;
+  static qint64 tileKey(int tileX, int tileY);
+  static qint64 tileKey(const Node& node);
+  void addToTile(qint64 key, AmoebotParticle* particle);
+  void removeFromTile(qint64 key, AmoebotParticle* particle);
+
   std::vector<AmoebotParticle*> particles;
-  std::map<Node, AmoebotParticle*> particleMap;
+  std::unordered_map<Node, AmoebotParticle*> particleMap;
+  std::unordered_map<qint64, std::vector<AmoebotParticle*>> tiles;
   std::set<AmoebotParticle*> activatedParticles;
   std::deque<Object*> objects;
-  std::map<Node, Object*> objectMap;
+  std::unordered_map<Node, Object*> objectMap;
+  LatticeExtent occupiedNodes;
   std::vector<Count*> _counts;
   std::vector<Measure*> _measures;
+  std::vector<IncrementalMeasure*> _incrementalMeasures;
+  unsigned int _numSyncedMeasures;
 };
 
 #endif  // AMOEBOTSIM_CORE_AMOEBOTSYSTEM_H_
@@ -0,0 +1,429 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/ensemblestatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include <QJsonArray>
+
+#include "core/metric.h"
+
+RunningStats::RunningStats()
+    : _count(0),
+      _mean(0),
+      _m2(0),
+      _min(std::numeric_limits<double>::infinity()),
+      _max(-std::numeric_limits<double>::infinity()) {}
+
+void RunningStats::add(double value) {
+  ++_count;
+  const double delta = value - _mean;
+  _mean += delta / _count;
+  _m2 += delta * (value - _mean);
+  _min = std::min(_min, value);
+  _max = std::max(_max, value);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+  if (other._count == 0) {
+    return;
+  } else if (_count == 0) {
+    *this = other;
+    return;
+  }
+
+  const double count = static_cast<double>(_count) + other._count;
+  const double delta = other._mean - _mean;
+  _mean += delta * other._count / count;
+  _m2 += other._m2 + delta * delta * _count * other._count / count;
+  _count += other._count;
+  _min = std::min(_min, other._min);
+  _max = std::max(_max, other._max);
+}
+
+quint64 RunningStats::count() const {
+  return _count;
+}
+
+double RunningStats::mean() const {
+  return _mean;
+}
+
+double RunningStats::variance() const {
+  return (_count < 2) ? 0.0 : _m2 / (_count - 1);
+}
+
+double RunningStats::stddev() const {
+  return std::sqrt(variance());
+}
+
+double RunningStats::min() const {
+  return _min;
+}
+
+double RunningStats::max() const {
+  return _max;
+}
+
+double RunningStats::confidenceHalfWidth(double z) const {
+  if (_count < 2) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return z * stddev() / std::sqrt(static_cast<double>(_count));
+}
+
+QJsonObject RunningStats::toJson() const {
+  QJsonObject json;
+  json.insert("count", static_cast<double>(_count));
+  json.insert("mean", _mean);
+  json.insert("m2", _m2);
+  if (_count > 0) {
+    json.insert("min", _min);
+    json.insert("max", _max);
+  }
+  return json;
+}
+
+RunningStats RunningStats::fromJson(const QJsonObject& json) {
+  RunningStats stats;
+  stats._count = static_cast<quint64>(json.value("count").toDouble());
+  stats._mean = json.value("mean").toDouble();
+  stats._m2 = json.value("m2").toDouble();
+  if (stats._count > 0) {
+    stats._min = json.value("min").toDouble();
+    stats._max = json.value("max").toDouble();
+  }
+  return stats;
+}
+
+QuantileSketch::QuantileSketch(unsigned int k)
+    : _k(std::max(2u, k)),
+      _count(0),
+      _levels(1),
+      _oddOffsets(1, false) {}
+
+void QuantileSketch::add(double value) {
+  _levels[0].push_back(value);
+  ++_count;
+  compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+  Q_ASSERT(_k == other._k);
+  while (_levels.size() < other._levels.size()) {
+    _levels.emplace_back();
+    _oddOffsets.push_back(false);
+  }
+  for (unsigned int h = 0; h < other._levels.size(); ++h) {
+    _levels[h].insert(_levels[h].end(), other._levels[h].begin(),
+                      other._levels[h].end());
+  }
+  _count += other._count;
+  compress();
+}
+
+quint64 QuantileSketch::count() const {
+  return _count;
+}
+
+double QuantileSketch::quantile(double q) const {
+  if (_count == 0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+
+  std::vector<std::pair<double, quint64>> weighted;
+  for (unsigned int h = 0; h < _levels.size(); ++h) {
+    for (double value : _levels[h]) {
+      weighted.push_back(std::make_pair(value, quint64(1) << h));
+    }
+  }
+  std::sort(weighted.begin(), weighted.end());
+
+  const double target = std::min(std::max(q, 0.0), 1.0) * _count;
+  quint64 cumulative = 0;
+  for (const auto& entry : weighted) {
+    cumulative += entry.second;
+    if (cumulative >= target) {
+      return entry.first;
+    }
+  }
+  return weighted.back().first;
+}
+
+QJsonObject QuantileSketch::toJson() const {
+  QJsonArray levels, odd;
+  for (unsigned int h = 0; h < _levels.size(); ++h) {
+    QJsonArray level;
+    for (double value : _levels[h]) {
+      level.append(value);
+    }
+    levels.append(level);
+    odd.append(static_cast<bool>(_oddOffsets[h]));
+  }
+
+  QJsonObject json;
+  json.insert("k", static_cast<int>(_k));
+  json.insert("count", static_cast<double>(_count));
+  json.insert("levels", levels);
+  json.insert("odd", odd);
+  return json;
+}
+
+QuantileSketch QuantileSketch::fromJson(const QJsonObject& json) {
+  QuantileSketch sketch(json.value("k").toInt());
+  sketch._count = static_cast<quint64>(json.value("count").toDouble());
+  const QJsonArray levels = json.value("levels").toArray();
+  const QJsonArray odd = json.value("odd").toArray();
+  sketch._levels.assign(std::max(1, levels.size()), std::vector<double>());
+  sketch._oddOffsets.assign(sketch._levels.size(), false);
+  for (int h = 0; h < levels.size(); ++h) {
+    for (const QJsonValue& value : levels[h].toArray()) {
+      sketch._levels[h].push_back(value.toDouble());
+    }
+    sketch._oddOffsets[h] = odd[h].toBool();
+  }
+  return sketch;
+}
+
+unsigned int QuantileSketch::capacity(unsigned int level) const {
+  const unsigned int depth = _levels.size() - 1 - level;
+  return std::max(2u, static_cast<unsigned int>(
+                          std::ceil(_k * std::pow(2.0 / 3.0, depth))));
+}
+
+void QuantileSketch::compress() {
+  while (true) {
+    unsigned int size = 0, totalCapacity = 0;
+    for (unsigned int h = 0; h < _levels.size(); ++h) {
+      size += _levels[h].size();
+      totalCapacity += capacity(h);
+    }
+    if (size <= totalCapacity) {
+      return;
+    }
+
+    unsigned int h = 0;
+    while (_levels[h].size() < capacity(h)) {
+      ++h;
+    }
+    if (h + 1 == _levels.size()) {
+      _levels.emplace_back();
+      _oddOffsets.push_back(false);
+    }
+
+    // Promote every other value of an even number of the level's values to
+    // the next level; an odd one out stays.
+    std::vector<double>& level = _levels[h];
+    std::sort(level.begin(), level.end());
+    const unsigned int numPaired = level.size() - level.size() % 2;
+    const unsigned int offset = _oddOffsets[h] ? 1 : 0;
+    _oddOffsets[h] = !_oddOffsets[h];
+    for (unsigned int i = offset; i < numPaired; i += 2) {
+      _levels[h + 1].push_back(level[i]);
+    }
+    level.erase(level.begin(), level.begin() + numPaired);
+  }
+}
+
+EnsembleStatistics::EnsembleStatistics(unsigned int roundStride,
+                                       unsigned int sketchSize)
+    : _roundStride(std::max(1u, roundStride)),
+      _sketchSize(sketchSize),
+      _numTrials(0),
+      _terminationRounds(newCell()),
+      _terminationSteps(newCell()) {}
+
+void EnsembleStatistics::addTrial(const System& system, bool terminated,
+                                  quint64 steps) {
+  ++_numTrials;
+  if (terminated) {
+    const double rounds = system.getCount("# Rounds")._value;
+    _terminationRounds.stats.add(rounds);
+    _terminationRounds.sketch.add(rounds);
+    _terminationSteps.stats.add(steps);
+    _terminationSteps.sketch.add(steps);
+  }
+
+  for (const Count* c : system.getCounts()) {
+    for (unsigned int i = 0; i < c->_history.size(); ++i) {
+      addValue(c->_name, c->_history.roundAt(i), c->_history.at(i));
+    }
+  }
+  for (const Measure* m : system.getMeasures()) {
+    for (unsigned int i = 0; i < m->_history.size(); ++i) {
+      addValue(m->_name, m->_history.roundAt(i), m->_history.at(i));
+    }
+  }
+}
+
+bool EnsembleStatistics::canMerge(const EnsembleStatistics& other) const {
+  return _roundStride == other._roundStride
+         && _sketchSize == other._sketchSize;
+}
+
+void EnsembleStatistics::merge(const EnsembleStatistics& other) {
+  Q_ASSERT(canMerge(other));
+  _numTrials += other._numTrials;
+  _terminationRounds.stats.merge(other._terminationRounds.stats);
+  _terminationRounds.sketch.merge(other._terminationRounds.sketch);
+  _terminationSteps.stats.merge(other._terminationSteps.stats);
+  _terminationSteps.sketch.merge(other._terminationSteps.sketch);
+
+  for (const auto& metric : other._metrics) {
+    std::map<quint64, Cell>& cells = _metrics[metric.first];
+    for (const auto& cell : metric.second) {
+      auto it = cells.find(cell.first);
+      if (it == cells.end()) {
+        cells.emplace(cell.first, cell.second);
+      } else {
+        it->second.stats.merge(cell.second.stats);
+        it->second.sketch.merge(cell.second.sketch);
+      }
+    }
+  }
+}
+
+quint64 EnsembleStatistics::numTrials() const {
+  return _numTrials;
+}
+
+quint64 EnsembleStatistics::numTerminated() const {
+  return _terminationRounds.stats.count();
+}
+
+const EnsembleStatistics::Cell& EnsembleStatistics::terminationRounds() const {
+  return _terminationRounds;
+}
+
+const EnsembleStatistics::Cell& EnsembleStatistics::terminationSteps() const {
+  return _terminationSteps;
+}
+
+QJsonObject EnsembleStatistics::summary(
+    const std::vector<double>& quantiles) const {
+  auto cellSummary = [&quantiles](const Cell& cell) {
+    QJsonObject json;
+    json.insert("count", static_cast<double>(cell.stats.count()));
+    if (cell.stats.count() == 0) {
+      return json;
+    }
+    json.insert("mean", cell.stats.mean());
+    json.insert("stddev", cell.stats.stddev());
+    json.insert("min", cell.stats.min());
+    json.insert("max", cell.stats.max());
+    if (cell.stats.count() >= 2) {
+      json.insert("ci95", cell.stats.confidenceHalfWidth());
+    }
+    QJsonArray values;
+    for (double q : quantiles) {
+      values.append(cell.sketch.quantile(q));
+    }
+    json.insert("quantiles", values);
+    return json;
+  };
+
+  QJsonObject metrics;
+  for (const auto& metric : _metrics) {
+    QJsonArray rounds;
+    for (const auto& cell : metric.second) {
+      QJsonObject json = cellSummary(cell.second);
+      json.insert("round", static_cast<double>(cell.first));
+      rounds.append(json);
+    }
+    metrics.insert(metric.first, rounds);
+  }
+
+  QJsonArray quantileList;
+  for (double q : quantiles) {
+    quantileList.append(q);
+  }
+
+  QJsonObject json;
+  json.insert("numTrials", static_cast<double>(_numTrials));
+  json.insert("numTerminated", static_cast<double>(numTerminated()));
+  json.insert("quantiles", quantileList);
+  json.insert("terminationRounds", cellSummary(_terminationRounds));
+  json.insert("terminationSteps", cellSummary(_terminationSteps));
+  json.insert("metrics", metrics);
+  return json;
+}
+
+QJsonObject EnsembleStatistics::toJson() const {
+  auto cellJson = [](const Cell& cell) {
+    QJsonObject json;
+    json.insert("stats", cell.stats.toJson());
+    json.insert("sketch", cell.sketch.toJson());
+    return json;
+  };
+
+  QJsonObject metrics;
+  for (const auto& metric : _metrics) {
+    QJsonArray rounds;
+    for (const auto& cell : metric.second) {
+      QJsonObject json = cellJson(cell.second);
+      json.insert("round", static_cast<double>(cell.first));
+      rounds.append(json);
+    }
+    metrics.insert(metric.first, rounds);
+  }
+
+  QJsonObject json;
+  json.insert("roundStride", static_cast<int>(_roundStride));
+  json.insert("sketchSize", static_cast<int>(_sketchSize));
+  json.insert("numTrials", static_cast<double>(_numTrials));
+  json.insert("terminationRounds", cellJson(_terminationRounds));
+  json.insert("terminationSteps", cellJson(_terminationSteps));
+  json.insert("metrics", metrics);
+  return json;
+}
+
+EnsembleStatistics EnsembleStatistics::fromJson(const QJsonObject& json) {
+  auto cellFromJson = [](const QJsonObject& json) {
+    return Cell{RunningStats::fromJson(json.value("stats").toObject()),
+                QuantileSketch::fromJson(json.value("sketch").toObject())};
+  };
+
+  EnsembleStatistics ensemble(json.value("roundStride").toInt(),
+                              json.value("sketchSize").toInt());
+  ensemble._numTrials =
+      static_cast<quint64>(json.value("numTrials").toDouble());
+  ensemble._terminationRounds =
+      cellFromJson(json.value("terminationRounds").toObject());
+  ensemble._terminationSteps =
+      cellFromJson(json.value("terminationSteps").toObject());
+
+  const QJsonObject metrics = json.value("metrics").toObject();
+  for (auto it = metrics.begin(); it != metrics.end(); ++it) {
+    std::map<quint64, Cell>& cells = ensemble._metrics[it.key()];
+    for (const QJsonValue& value : it.value().toArray()) {
+      const QJsonObject cell = value.toObject();
+      cells.emplace(static_cast<quint64>(cell.value("round").toDouble()),
+                    cellFromJson(cell));
+    }
+  }
+  return ensemble;
+}
+
+void EnsembleStatistics::addValue(const QString& name, quint64 round,
+                                  double value) {
+  if (round % _roundStride != 0) {
+    return;
+  }
+
+  std::map<quint64, Cell>& cells = _metrics[name];
+  auto it = cells.find(round);
+  if (it == cells.end()) {
+    it = cells.emplace(round, newCell()).first;
+  }
+  it->second.stats.add(value);
+  it->second.sketch.add(value);
+}
+
+EnsembleStatistics::Cell EnsembleStatistics::newCell() const {
+  return Cell{RunningStats(), QuantileSketch(_sketchSize)};
+}
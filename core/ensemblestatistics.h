@@ -0,0 +1,143 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines streaming statistics over ensembles of trials (independent runs of
+// the same algorithm instance). Trials are added as they finish and only
+// aggregates are kept, so memory does not grow with the number of trials.
+// Every aggregate can be merged with another one built from other trials,
+// e.g., on another thread or in another process, and serialized to JSON for
+// that purpose.
+
+#ifndef AMOEBOTSIM_CORE_ENSEMBLESTATISTICS_H_
+#define AMOEBOTSIM_CORE_ENSEMBLESTATISTICS_H_
+
+#include <map>
+#include <vector>
+
+#include <QJsonObject>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/system.h"
+
+// Count, mean, and variance of a stream of values, computed with Welford's
+// algorithm and merged with the pairwise update of Chan et al.
+class RunningStats {
+ public:
+  RunningStats();
+
+  void add(double value);
+  void merge(const RunningStats& other);
+
+  // Functions for accessing the statistics. variance is the unbiased sample
+  // variance (0 for fewer than two values). confidenceHalfWidth returns the
+  // half-width of the normal-approximation confidence interval of the mean for
+  // the given z-score (1.96 for 95%), or infinity for fewer than two values.
+  quint64 count() const;
+  double mean() const;
+  double variance() const;
+  double stddev() const;
+  double min() const;
+  double max() const;
+  double confidenceHalfWidth(double z = 1.96) const;
+
+  QJsonObject toJson() const;
+  static RunningStats fromJson(const QJsonObject& json);
+
+ private:
+  quint64 _count;
+  double _mean;
+  double _m2;
+  double _min, _max;
+};
+
+// A mergeable quantile sketch in the style of Karnin, Lang, and Liberty (KLL).
+// Values are kept in a hierarchy of compactors; when a level is full, it is
+// sorted and every other value is promoted to the next level with twice the
+// weight. Memory is O(k log(n / k)) for n values, and the rank error of a
+// quantile is about 1 / k. Compaction alternates between keeping the odd and
+// the even values instead of flipping coins, so sketches are deterministic.
+class QuantileSketch {
+ public:
+  explicit QuantileSketch(unsigned int k = 128);
+
+  void add(double value);
+  void merge(const QuantileSketch& other);
+
+  // Returns the number of values added, and the value whose rank is the given
+  // fraction q in [0,1] of them (NaN if the sketch is empty).
+  quint64 count() const;
+  double quantile(double q) const;
+
+  QJsonObject toJson() const;
+  static QuantileSketch fromJson(const QJsonObject& json);
+
+ private:
+  // Returns the capacity of the given level, which shrinks geometrically
+  // towards the lower levels.
+  unsigned int capacity(unsigned int level) const;
+
+  // Compacts the lowest level over its capacity until the sketch fits.
+  void compress();
+
+  unsigned int _k;
+  quint64 _count;
+  std::vector<std::vector<double>> _levels;
+  std::vector<bool> _oddOffsets;
+};
+
+// Aggregates the metric histories and termination times of trials. For every
+// count and measure, the values recorded in each round are summarized across
+// trials by RunningStats and a QuantileSketch. Only rounds that are multiples
+// of roundStride are kept, which bounds memory for long runs.
+class EnsembleStatistics {
+ public:
+  // The summary of one metric in one round across trials.
+  struct Cell {
+    RunningStats stats;
+    QuantileSketch sketch;
+  };
+
+  explicit EnsembleStatistics(unsigned int roundStride = 1,
+                              unsigned int sketchSize = 128);
+
+  // Adds a finished trial: the metric histories of the given system and
+  // whether and when (in rounds and activations) it terminated.
+  void addTrial(const System& system, bool terminated, quint64 steps);
+
+  // Adds the trials aggregated by another instance. canMerge tells whether
+  // the other instance has the same round stride and sketch size, which merge
+  // requires.
+  bool canMerge(const EnsembleStatistics& other) const;
+  void merge(const EnsembleStatistics& other);
+
+  // Functions for accessing the aggregates. numTrials counts all trials, and
+  // terminationRounds and terminationSteps describe the trials that
+  // terminated.
+  quint64 numTrials() const;
+  quint64 numTerminated() const;
+  const Cell& terminationRounds() const;
+  const Cell& terminationSteps() const;
+
+  // Returns a summary for reports, with the given quantiles of every cell.
+  // Unlike toJson, the summary cannot be merged.
+  QJsonObject summary(const std::vector<double>& quantiles) const;
+
+  QJsonObject toJson() const;
+  static EnsembleStatistics fromJson(const QJsonObject& json);
+
+ private:
+  // Adds the given value of the given metric in the given round.
+  void addValue(const QString& name, quint64 round, double value);
+  Cell newCell() const;
+
+  unsigned int _roundStride;
+  unsigned int _sketchSize;
+  quint64 _numTrials;
+  Cell _terminationRounds;
+  Cell _terminationSteps;
+  std::map<QString, std::map<quint64, Cell>> _metrics;
+};
+
+#endif  // AMOEBOTSIM_CORE_ENSEMBLESTATISTICS_H_
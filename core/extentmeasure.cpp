@@ -0,0 +1,247 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/extentmeasure.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/amoebotparticle.h"
+
+namespace {
+
+// Returns the cross product of (b - a) and (c - a) in lattice coordinates. The
+// lattice coordinates are an affine image of the Cartesian ones, so the sign of
+// this product (and the ratio of two such products) agrees with the Cartesian
+// one, which is all the convex hull and rotating calipers depend on.
+qint64 cross(const Node& a, const Node& b, const Node& c) {
+  return static_cast<qint64>(b.x - a.x) * (c.y - a.y)
+         - static_cast<qint64>(b.y - a.y) * (c.x - a.x);
+}
+
+// Increments (resp., decrements) the multiplicity of the given key, removing it
+// once its multiplicity drops to zero.
+void increment(std::map<int, int>& multiplicities, int key) {
+  ++multiplicities[key];
+}
+
+void decrement(std::map<int, int>& multiplicities, int key) {
+  auto it = multiplicities.find(key);
+  Q_ASSERT(it != multiplicities.end());
+  if (--it->second == 0) {
+    multiplicities.erase(it);
+  }
+}
+
+}  // namespace
+
+LatticeExtent::LatticeExtent()
+    : _size(0),
+      _sumDoubledX(0),
+      _sumY(0),
+      _sumDoubledXSq(0),
+      _sumYSq(0) {}
+
+void LatticeExtent::insert(const Node& node) {
+  const qint64 doubledX = 2 * node.x + node.y;
+  increment(_rows[node.y], node.x);
+  increment(_doubledXs, static_cast<int>(doubledX));
+  ++_size;
+  _sumDoubledX += doubledX;
+  _sumY += node.y;
+  _sumDoubledXSq += doubledX * doubledX;
+  _sumYSq += static_cast<qint64>(node.y) * node.y;
+}
+
+void LatticeExtent::erase(const Node& node) {
+  auto row = _rows.find(node.y);
+  Q_ASSERT(row != _rows.end());
+  decrement(row->second, node.x);
+  if (row->second.empty()) {
+    _rows.erase(row);
+  }
+
+  const qint64 doubledX = 2 * node.x + node.y;
+  decrement(_doubledXs, static_cast<int>(doubledX));
+  --_size;
+  _sumDoubledX -= doubledX;
+  _sumY -= node.y;
+  _sumDoubledXSq -= doubledX * doubledX;
+  _sumYSq -= static_cast<qint64>(node.y) * node.y;
+}
+
+void LatticeExtent::clear() {
+  *this = LatticeExtent();
+}
+
+quint64 LatticeExtent::size() const {
+  return _size;
+}
+
+double LatticeExtent::left() const {
+  return _doubledXs.empty() ? 0.0 : _doubledXs.begin()->first / 2.0;
+}
+
+double LatticeExtent::right() const {
+  return _doubledXs.empty() ? 0.0 : _doubledXs.rbegin()->first / 2.0;
+}
+
+double LatticeExtent::bottom() const {
+  return _rows.empty() ? 0.0 : std::sqrt(3.0) / 2 * _rows.begin()->first;
+}
+
+double LatticeExtent::top() const {
+  return _rows.empty() ? 0.0 : std::sqrt(3.0) / 2 * _rows.rbegin()->first;
+}
+
+double LatticeExtent::centroidX() const {
+  return _size == 0 ? 0.0 : _sumDoubledX / (2.0 * _size);
+}
+
+double LatticeExtent::centroidY() const {
+  return _size == 0 ? 0.0 : std::sqrt(3.0) / 2 * _sumY / _size;
+}
+
+double LatticeExtent::radiusOfGyration() const {
+  if (_size == 0) {
+    return 0.0;
+  }
+
+  // Cartesian coordinates are (2x + y) / 2 and y * sqrt(3) / 2, so the variance
+  // of the former is a quarter and the variance of the latter three quarters of
+  // the variance of the corresponding integer coordinate.
+  const double n = static_cast<double>(_size);
+  const double varDoubledX =
+      (_sumDoubledXSq - _sumDoubledX * (_sumDoubledX / n)) / n;
+  const double varY = (_sumYSq - _sumY * (_sumY / n)) / n;
+  return std::sqrt(std::max(0.0, varDoubledX / 4 + 3 * varY / 4));
+}
+
+std::vector<Node> LatticeExtent::convexHull() const {
+  // The leftmost and rightmost node of each row, in (y, x) lexicographic order.
+  std::vector<Node> points;
+  points.reserve(2 * _rows.size());
+  for (const auto& row : _rows) {
+    points.push_back(Node(row.second.begin()->first, row.first));
+    if (row.second.size() > 1) {
+      points.push_back(Node(row.second.rbegin()->first, row.first));
+    }
+  }
+
+  if (points.size() < 3) {
+    return points;
+  }
+
+  // Andrew's monotone chain; the points are already sorted.
+  std::vector<Node> hull(2 * points.size());
+  size_t k = 0;
+  for (size_t i = 0; i < points.size(); ++i) {
+    while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0) {
+      --k;
+    }
+    hull[k++] = points[i];
+  }
+  for (size_t i = points.size() - 1, lower = k + 1; i > 0; --i) {
+    while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i - 1]) <= 0) {
+      --k;
+    }
+    hull[k++] = points[i - 1];
+  }
+  hull.resize(k - 1);
+
+  return hull;
+}
+
+double LatticeExtent::diameter() const {
+  const std::vector<Node> hull = convexHull();
+  const size_t m = hull.size();
+  if (m < 2) {
+    return 0.0;
+  } else if (m == 2) {
+    return std::sqrt(static_cast<double>(squaredDistance(hull[0], hull[1])));
+  }
+
+  // Rotating calipers: for each hull edge, advance the antipodal vertex while
+  // it gets farther from the edge. The farthest pair of nodes is among the
+  // antipodal pairs visited this way.
+  qint64 maxSqDist = 0;
+  size_t j = 1;
+  for (size_t i = 0; i < m; ++i) {
+    const Node& a = hull[i];
+    const Node& b = hull[(i + 1) % m];
+    while (cross(a, b, hull[(j + 1) % m]) > cross(a, b, hull[j])) {
+      j = (j + 1) % m;
+    }
+    maxSqDist = std::max(maxSqDist, std::max(squaredDistance(a, hull[j]),
+                                             squaredDistance(b, hull[j])));
+  }
+
+  return std::sqrt(static_cast<double>(maxSqDist));
+}
+
+qint64 LatticeExtent::squaredDistance(const Node& node1, const Node& node2) {
+  const qint64 dx = node2.x - node1.x;
+  const qint64 dy = node2.y - node1.y;
+  return dx * dx + dx * dy + dy * dy;
+}
+
+ExtentMeasure::ExtentMeasure(const QString name, const unsigned int freq,
+                             const System& system, Tracked tracked)
+    : IncrementalMeasure(name, freq),
+      _system(system),
+      _tracked(tracked) {}
+
+void ExtentMeasure::initialize() {
+  _extent.clear();
+  for (const Particle& p : _system) {
+    _extent.insert(p.head);
+    if (_tracked == Tracked::Nodes && p.isExpanded()) {
+      _extent.insert(p.tail());
+    }
+  }
+}
+
+void ExtentMeasure::nodeOccupied(const Node& node) {
+  if (_tracked == Tracked::Nodes) {
+    _extent.insert(node);
+  }
+}
+
+void ExtentMeasure::nodeVacated(const Node& node) {
+  if (_tracked == Tracked::Nodes) {
+    _extent.erase(node);
+  }
+}
+
+void ExtentMeasure::particleMoved(const AmoebotParticle& particle,
+                                  const Node& oldHead, int oldGlobalTailDir) {
+  Q_UNUSED(oldGlobalTailDir);
+  if (_tracked == Tracked::Heads && particle.head != oldHead) {
+    _extent.erase(oldHead);
+    _extent.insert(particle.head);
+  }
+}
+
+void ExtentMeasure::particleInserted(const AmoebotParticle& particle) {
+  if (_tracked == Tracked::Heads) {
+    _extent.insert(particle.head);
+  }
+}
+
+const LatticeExtent& ExtentMeasure::extent() const {
+  return _extent;
+}
+
+double DiameterMeasure::calculate() const {
+  return _extent.diameter();
+}
+
+double BoundingBoxAreaMeasure::calculate() const {
+  return (_extent.right() - _extent.left())
+         * (_extent.top() - _extent.bottom());
+}
+
+double RadiusOfGyrationMeasure::calculate() const {
+  return _extent.radiusOfGyration();
+}
@@ -0,0 +1,137 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines measures of the geometric extent of a particle system (its diameter,
+// bounding box, and radius of gyration) that any algorithm can add to its
+// system. All of them are incremental: the set of measured nodes is updated on
+// every movement, and the extent is derived from it without looking at every
+// particle. Distances are Cartesian, i.e., measured in the plane the
+// triangular lattice is embedded in with unit edge length.
+
+#ifndef AMOEBOTSIM_CORE_EXTENTMEASURE_H_
+#define AMOEBOTSIM_CORE_EXTENTMEASURE_H_
+
+#include <map>
+#include <vector>
+
+#include <QString>
+#include <QtGlobal>
+
+#include "core/metric.h"
+#include "core/node.h"
+#include "core/system.h"
+
+class LatticeExtent {
+ public:
+  // Constructs an empty extent.
+  LatticeExtent();
+
+  // Functions for maintaining the measured multiset of nodes. insert adds a
+  // node, erase removes one occurrence of a previously inserted node, and clear
+  // removes all nodes. These take O(log n) time.
+  void insert(const Node& node);
+  void erase(const Node& node);
+  void clear();
+  quint64 size() const;
+
+  // Returns the Cartesian bounding box of the nodes. These take O(1) time and
+  // return 0 if there are no nodes.
+  double left() const;
+  double right() const;
+  double bottom() const;
+  double top() const;
+
+  // Returns the Cartesian centroid of the nodes and their radius of gyration,
+  // i.e., their root mean squared distance to the centroid. These take O(1)
+  // time and return 0 if there are no nodes.
+  double centroidX() const;
+  double centroidY() const;
+  double radiusOfGyration() const;
+
+  // Returns the vertices of the convex hull of the nodes in counter-clockwise
+  // order, without collinear points. Only the leftmost and rightmost node of
+  // each lattice row can be a hull vertex, so this takes O(r) time for r rows.
+  std::vector<Node> convexHull() const;
+
+  // Returns the largest Cartesian distance between any two nodes, found by
+  // rotating calipers around the convex hull in O(r) time for r rows.
+  double diameter() const;
+
+  // Returns the squared Cartesian distance between two nodes, which is an
+  // integer for nodes of the triangular lattice.
+  static qint64 squaredDistance(const Node& node1, const Node& node2);
+
+ private:
+  // Multiplicities of the nodes, by row (y-coordinate) and then x-coordinate.
+  std::map<int, std::map<int, int>> _rows;
+
+  // Multiplicities of the doubled Cartesian x-coordinates (2x + y) of the
+  // nodes, used to maintain the horizontal extent of the bounding box.
+  std::map<int, int> _doubledXs;
+
+  // Running sums for the centroid and radius of gyration, kept in integer
+  // coordinates (2x + y and y) to avoid accumulating rounding errors.
+  quint64 _size;
+  qint64 _sumDoubledX, _sumY;
+  qint64 _sumDoubledXSq, _sumYSq;
+};
+
+class ExtentMeasure : public IncrementalMeasure {
+ public:
+  // Which nodes of the system are measured: the heads of all particles, or all
+  // nodes occupied by particles (heads and tails).
+  enum class Tracked {
+    Heads,
+    Nodes
+  };
+
+  // Constructs an extent measure with a given name and calculation frequency
+  // for the given system, measuring the given nodes.
+  ExtentMeasure(const QString name, const unsigned int freq,
+                const System& system, Tracked tracked = Tracked::Nodes);
+
+  // Collects the measured nodes from scratch and updates them as particles are
+  // inserted or move.
+  void initialize() final;
+  void nodeOccupied(const Node& node) final;
+  void nodeVacated(const Node& node) final;
+  void particleMoved(const AmoebotParticle& particle, const Node& oldHead,
+                     int oldGlobalTailDir) final;
+  void particleInserted(const AmoebotParticle& particle) final;
+
+  // Returns the extent of the measured nodes, e.g., to derive several values
+  // from a single measure.
+  const LatticeExtent& extent() const;
+
+ protected:
+  const System& _system;
+  const Tracked _tracked;
+  LatticeExtent _extent;
+};
+
+class DiameterMeasure : public ExtentMeasure {
+ public:
+  using ExtentMeasure::ExtentMeasure;
+
+  // Calculates the largest Cartesian distance between any two measured nodes.
+  double calculate() const override;
+};
+
+class BoundingBoxAreaMeasure : public ExtentMeasure {
+ public:
+  using ExtentMeasure::ExtentMeasure;
+
+  // Calculates the area of the Cartesian bounding box of the measured nodes.
+  double calculate() const override;
+};
+
+class RadiusOfGyrationMeasure : public ExtentMeasure {
+ public:
+  using ExtentMeasure::ExtentMeasure;
+
+  // Calculates the radius of gyration of the measured nodes.
+  double calculate() const override;
+};
+
+#endif  // AMOEBOTSIM_CORE_EXTENTMEASURE_H_
@@ -10,7 +10,7 @@ Count::Count(const QString name)
   : _name(name),
     _value(0) {}
 
-void Count::record(const unsigned int numEvents) {
+void Count::record(const quint64 numEvents) {
   _value += numEvents;
 }
 
@@ -19,3 +19,33 @@ Measure::Measure(const QString name, const unsigned int freq)
     _freq(freq) {}
 
 Measure::~Measure() {}
+
+IncrementalMeasure::IncrementalMeasure(const QString name,
+                                       const unsigned int freq)
+  : Measure(name, freq) {}
+
+IncrementalMeasure::~IncrementalMeasure() {}
+
+void IncrementalMeasure::nodeOccupied(const Node& node) {
+  Q_UNUSED(node);
+}
+
+void IncrementalMeasure::nodeVacated(const Node& node) {
+  Q_UNUSED(node);
+}
+
+void IncrementalMeasure::particleMoved(const AmoebotParticle& particle,
+                                       const Node& oldHead,
+                                       int oldGlobalTailDir) {
+  Q_UNUSED(particle);
+  Q_UNUSED(oldHead);
+  Q_UNUSED(oldGlobalTailDir);
+}
+
+void IncrementalMeasure::particleInserted(const AmoebotParticle& particle) {
+  Q_UNUSED(particle);
+}
+
+void IncrementalMeasure::stateChanged(const AmoebotParticle& particle) {
+  Q_UNUSED(particle);
+}
@@ -8,11 +8,115 @@
 #ifndef AMOEBOTSIM_CORE_METRIC_H_
 #define AMOEBOTSIM_CORE_METRIC_H_
 
+#include <algorithm>
 #include <deque>
 #include <map>
 #include <vector>
 
 #include <QString>
+#include <QtGlobal>
+
+#include "core/node.h"
+
+// AmoebotParticle must be forward declared to avoid a cyclic dependency.
+class AmoebotParticle;
+
+// Policies for how much of a metric's history is retained. Full keeps every
+// sample. Ring keeps only the most recent samples, up to a fixed capacity.
+// Geometric keeps the samples whose indices form a geometric sequence with the
+// given ratio (a ratio of 2 gives logarithmic sampling), so memory grows only
+// logarithmically in the number of rounds. Buckets keeps at most a fixed number
+// of buckets, each aggregating the min/max/mean of a run of consecutive
+// samples; when all buckets are in use, adjacent buckets are merged pairwise
+// and the bucket width doubles.
+enum class HistoryPolicy {
+  Full,
+  Ring,
+  Geometric,
+  Buckets
+};
+
+template<class T>
+class History {
+ public:
+  // Iterator over the retained values of a history in chronological order.
+  class Iterator {
+   public:
+    Iterator(const History* history, unsigned int pos);
+    bool operator!=(const Iterator& other) const;
+    T operator*() const;
+    const Iterator& operator++();
+
+   private:
+    const History* _history;
+    unsigned int _pos;
+  };
+
+  // Constructs an empty history that retains every sample.
+  History();
+
+  // Changes the retention policy of this history. capacity is the maximum
+  // number of retained samples (resp., buckets) for Ring (resp., Buckets) and
+  // ratio is the growth ratio for Geometric; both are ignored otherwise.
+  // Already retained samples are replayed into the new policy.
+  void setPolicy(HistoryPolicy policy, unsigned int capacity = 0,
+                 double ratio = 2.0);
+  HistoryPolicy policy() const;
+
+  // Records a new sample taken in the given round. The sample is always
+  // available through back() but may not be retained, depending on the policy.
+  void push(T value, quint64 round);
+  void clear();
+
+  // Functions for accessing the retained samples, in chronological order. size
+  // returns the number of retained samples (or buckets), numSamples the number
+  // of samples ever pushed, and isComplete whether every pushed sample is
+  // retained individually. at and roundAt return the value and the round of the
+  // i-th retained sample; for buckets, these are the value of the bucket's last
+  // sample and the round of its first sample. minAt, maxAt, and meanAt return
+  // the aggregates of the i-th bucket, or the plain sample value for the other
+  // policies.
+  unsigned int size() const;
+  bool empty() const;
+  quint64 numSamples() const;
+  bool isComplete() const;
+  T back() const;
+  T at(unsigned int i) const;
+  quint64 roundAt(unsigned int i) const;
+  T minAt(unsigned int i) const;
+  T maxAt(unsigned int i) const;
+  double meanAt(unsigned int i) const;
+
+  // Returns the contiguous array of retained values if this history is
+  // complete; only meaningful for the Full policy.
+  const std::vector<T>& data() const;
+
+  // STL-like begin and end functions for range-based loops.
+  Iterator begin() const;
+  Iterator end() const;
+
+ private:
+  // Merges adjacent buckets pairwise, halving their number.
+  void mergeBuckets();
+
+  HistoryPolicy _policy;
+  unsigned int _capacity;
+  double _ratio;
+
+  std::vector<T> _values;
+  std::vector<quint64> _rounds;
+  unsigned int _start;
+
+  std::vector<T> _mins, _maxs;
+  std::vector<double> _sums;
+  std::vector<quint64> _spans;
+  quint64 _width;
+
+  T _last;
+  quint64 _numSamples;
+  quint64 _firstRound, _stride;
+  double _nextKept;
+};
 
 class Count {
  public:
@@ -21,14 +125,14 @@ class Count {
 
   // Increments the value of this count by the number of events being recorded,
   // whose default is 1.
-  void record(const unsigned int numEvents = 1);
+  void record(const quint64 numEvents = 1);
 
   // Member variables. The count's name should be human-readable, as it is used
   // to represent this count in the GUI. The value of the count is what is
   // incremented. History records the count values over time, once per round.
   const QString _name;
-  unsigned int _value;
-  std::vector<int> _history;
+  quint64 _value;
+  History<quint64> _history;
 };
 
 class Measure {
@@ -49,7 +153,278 @@ class Measure {
   // measure values over time, once per round.
   const QString _name;
   const unsigned int _freq;
-  std::vector<double> _history;
+  History<double> _history;
 };
 
+class IncrementalMeasure : public Measure {
+ public:
+  // Constructs a new incremental measure with a given name and calculation
+  // frequency.
+  IncrementalMeasure(const QString name, const unsigned int freq);
+  virtual ~IncrementalMeasure();
+
+  // Computes the measure's internal state from scratch. This is called once by
+  // the AmoebotSystem being measured, before the first delta is delivered, so
+  // that measures can be added after the system's particles were inserted.
+  // This is a pure virtual function and must be overridden by child classes.
+  virtual void initialize() = 0;
+
+  // Delta callbacks, called by the AmoebotSystem being measured after each
+  // change to its configuration has been applied. nodeOccupied (resp.,
+  // nodeVacated) is called whenever a node becomes occupied (resp., unoccupied)
+  // by a particle; handovers do not change which nodes are occupied and thus
+  // do not trigger these. Nodes are occupied and vacated one at a time, so
+  // during these calls the system's occupancy differs from that of the previous
+  // call in the given node only. particleMoved is called for every particle
+  // whose head or tail changed, given its head and global tail direction before
+  // the change; a handover calls it for both particles involved.
+  // particleInserted is called after a particle is inserted (and after
+  // nodeOccupied was called for its nodes), and stateChanged is called when an
+  // algorithm reports that a particle's state changed via
+  // AmoebotSystem::registerStateChange. The default implementations do
+  // nothing, so child classes override only what they need.
+  virtual void nodeOccupied(const Node& node);
+  virtual void nodeVacated(const Node& node);
+  virtual void particleMoved(const AmoebotParticle& particle,
+                             const Node& oldHead, int oldGlobalTailDir);
+  virtual void particleInserted(const AmoebotParticle& particle);
+  virtual void stateChanged(const AmoebotParticle& particle);
+};
+
+template<class T>
+History<T>::Iterator::Iterator(const History* history, unsigned int pos)
+  : _history(history),
+    _pos(pos) {}
+
+template<class T>
+bool History<T>::Iterator::operator!=(const Iterator& other) const {
+  return _pos != other._pos;
+}
+
+template<class T>
+T History<T>::Iterator::operator*() const {
+  return _history->at(_pos);
+}
+
+template<class T>
+const typename History<T>::Iterator& History<T>::Iterator::operator++() {
+  ++_pos;
+  return *this;
+}
+
+template<class T>
+History<T>::History()
+  : _policy(HistoryPolicy::Full),
+    _capacity(0),
+    _ratio(2.0),
+    _start(0),
+    _width(1),
+    _last(T()),
+    _numSamples(0),
+    _firstRound(0),
+    _stride(1),
+    _nextKept(0.0) {}
+
+template<class T>
+void History<T>::setPolicy(HistoryPolicy policy, unsigned int capacity,
+                           double ratio) {
+  Q_ASSERT(policy != HistoryPolicy::Ring || capacity >= 1);
+  Q_ASSERT(policy != HistoryPolicy::Buckets || capacity >= 2);
+  Q_ASSERT(policy != HistoryPolicy::Geometric || ratio > 1.0);
+
+  std::vector<std::pair<T, quint64>> retained;
+  for (unsigned int i = 0; i < size(); ++i) {
+    retained.push_back(std::make_pair(at(i), roundAt(i)));
+  }
+
+  clear();
+  _policy = policy;
+  _capacity = capacity;
+  _ratio = ratio;
+  for (const auto& sample : retained) {
+    push(sample.first, sample.second);
+  }
+}
+
+template<class T>
+HistoryPolicy History<T>::policy() const {
+  return _policy;
+}
+
+template<class T>
+void History<T>::push(T value, quint64 round) {
+  if (_numSamples == 0) {
+    _firstRound = round;
+  } else if (_numSamples == 1) {
+    _stride = round - _firstRound;
+  }
+  const quint64 index = _numSamples++;
+  _last = value;
+
+  switch (_policy) {
+    case HistoryPolicy::Full: {
+      _values.push_back(value);
+      break;
+    }
+    case HistoryPolicy::Ring: {
+      if (_values.size() < _capacity) {
+        _values.push_back(value);
+        _rounds.push_back(round);
+      } else {
+        _values[_start] = value;
+        _rounds[_start] = round;
+        _start = (_start + 1) % _capacity;
+      }
+      break;
+    }
+    case HistoryPolicy::Geometric: {
+      if (index >= _nextKept) {
+        _values.push_back(value);
+        _rounds.push_back(round);
+        _nextKept = std::max(index + 1.0, index * _ratio);
+      }
+      break;
+    }
+    case HistoryPolicy::Buckets: {
+      if (!_values.empty() && _spans.back() < _width) {
+        _values.back() = value;
+        _mins.back() = std::min(_mins.back(), value);
+        _maxs.back() = std::max(_maxs.back(), value);
+        _sums.back() += value;
+        ++_spans.back();
+      } else {
+        if (_values.size() == _capacity) {
+          mergeBuckets();
+        }
+        _values.push_back(value);
+        _rounds.push_back(round);
+        _mins.push_back(value);
+        _maxs.push_back(value);
+        _sums.push_back(value);
+        _spans.push_back(1);
+      }
+      break;
+    }
+  }
+}
+
+template<class T>
+void History<T>::clear() {
+  _values.clear();
+  _rounds.clear();
+  _start = 0;
+  _mins.clear();
+  _maxs.clear();
+  _sums.clear();
+  _spans.clear();
+  _width = 1;
+  _last = T();
+  _numSamples = 0;
+  _firstRound = 0;
+  _stride = 1;
+  _nextKept = 0.0;
+}
+
+template<class T>
+unsigned int History<T>::size() const {
+  return _values.size();
+}
+
+template<class T>
+bool History<T>::empty() const {
+  return _numSamples == 0;
+}
+
+template<class T>
+quint64 History<T>::numSamples() const {
+  return _numSamples;
+}
+
+template<class T>
+bool History<T>::isComplete() const {
+  return _policy == HistoryPolicy::Full;
+}
+
+template<class T>
+T History<T>::back() const {
+  Q_ASSERT(!empty());
+  return _last;
+}
+
+template<class T>
+T History<T>::at(unsigned int i) const {
+  Q_ASSERT(i < size());
+  return (_policy == HistoryPolicy::Ring) ? _values[(_start + i) % size()]
+                                          : _values[i];
+}
+
+template<class T>
+quint64 History<T>::roundAt(unsigned int i) const {
+  Q_ASSERT(i < size());
+  switch (_policy) {
+    case HistoryPolicy::Full:   return _firstRound + i * _stride;
+    case HistoryPolicy::Ring:   return _rounds[(_start + i) % size()];
+    default:                    return _rounds[i];
+  }
+}
+
+template<class T>
+T History<T>::minAt(unsigned int i) const {
+  return (_policy == HistoryPolicy::Buckets) ? _mins.at(i) : at(i);
+}
+
+template<class T>
+T History<T>::maxAt(unsigned int i) const {
+  return (_policy == HistoryPolicy::Buckets) ? _maxs.at(i) : at(i);
+}
+
+template<class T>
+double History<T>::meanAt(unsigned int i) const {
+  return (_policy == HistoryPolicy::Buckets) ? _sums.at(i) / _spans.at(i)
+                                             : at(i);
+}
+
+template<class T>
+const std::vector<T>& History<T>::data() const {
+  return _values;
+}
+
+template<class T>
+typename History<T>::Iterator History<T>::begin() const {
+  return Iterator(this, 0);
+}
+
+template<class T>
+typename History<T>::Iterator History<T>::end() const {
+  return Iterator(this, size());
+}
+
+template<class T>
+void History<T>::mergeBuckets() {
+  unsigned int merged = 0;
+  for (unsigned int i = 0; i < _values.size(); i += 2, ++merged) {
+    _rounds[merged] = _rounds[i];
+    _values[merged] = _values[i];
+    _mins[merged] = _mins[i];
+    _maxs[merged] = _maxs[i];
+    _sums[merged] = _sums[i];
+    _spans[merged] = _spans[i];
+    if (i + 1 < _values.size()) {
+      _values[merged] = _values[i + 1];
+      _mins[merged] = std::min(_mins[merged], _mins[i + 1]);
+      _maxs[merged] = std::max(_maxs[merged], _maxs[i + 1]);
+      _sums[merged] += _sums[i + 1];
+      _spans[merged] += _spans[i + 1];
+    }
+  }
+
+  _values.resize(merged);
+  _rounds.resize(merged);
+  _mins.resize(merged);
+  _maxs.resize(merged);
+  _sums.resize(merged);
+  _spans.resize(merged);
+  _width *= 2;
+}
+
 #endif  // AMOEBOTSIM_CORE_METRIC_H_
@@ -0,0 +1,387 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/metricsfile.h"
+
+#include <cstring>
+#include <functional>
+
+#include <QtEndian>
+
+// Sizes and version of the binary metrics format; see metricsfile.h.
+static constexpr char magic[8] = {'A', 'M', 'B', 'M', 'E', 'T', 'R', 'C'};
+static constexpr quint32 formatVersion = 1;
+static constexpr int headerSize = 32;
+static constexpr int columnEntrySize = 48;
+
+// Helpers for appending little-endian values to (and reading them from) a byte
+// buffer, independent of the host's byte order.
+template<class T>
+static void appendLE(QByteArray& buffer, T value) {
+  uchar bytes[sizeof(T)];
+  qToLittleEndian<T>(value, bytes);
+  buffer.append(reinterpret_cast<const char*>(bytes), sizeof(T));
+}
+
+template<class T>
+static void writeLE(QByteArray& buffer, int offset, T value) {
+  qToLittleEndian<T>(value, reinterpret_cast<uchar*>(buffer.data() + offset));
+}
+
+template<class T>
+static T readLE(const uchar* data) {
+  return qFromLittleEndian<T>(data);
+}
+
+static void padTo8(QByteArray& buffer) {
+  while (buffer.size() % 8 != 0) {
+    buffer.append('\0');
+  }
+}
+
+static void appendVarint(QByteArray& buffer, qint64 value) {
+  // Zigzag encoding maps small negative and positive values to small unsigned
+  // values, which LEB128 then stores in as few bytes as possible.
+  quint64 zigzag = (static_cast<quint64>(value) << 1) ^
+                   static_cast<quint64>(value >> 63);
+  while (zigzag >= 0x80) {
+    buffer.append(static_cast<char>((zigzag & 0x7f) | 0x80));
+    zigzag >>= 7;
+  }
+  buffer.append(static_cast<char>(zigzag));
+}
+
+// A column to be serialized: its directory fields and a function appending its
+// data to the buffer.
+struct ColumnSpec {
+  MetricsFile::Kind kind;
+  MetricsFile::Encoding encoding;
+  quint32 freq;
+  quint64 numSamples;
+  QByteArray name;
+  std::function<void(QByteArray&)> writeData;
+};
+
+// Appends the column specs of the given history: the value column itself and,
+// if the history does not retain every sample, its auxiliary columns.
+template<class T>
+static void addHistoryColumns(std::vector<ColumnSpec>& columns,
+                              MetricsFile::Kind kind, bool deltaEncode,
+                              quint32 freq, const QString name,
+                              const History<T>& history) {
+  typedef MetricsFile::Kind Kind;
+  typedef MetricsFile::Encoding Encoding;
+  const QByteArray utf8 = name.toUtf8();
+  const quint64 n = history.size();
+  auto appendDouble = [](QByteArray& buffer, double val) {
+    quint64 bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    appendLE<quint64>(buffer, bits);
+  };
+
+  if (kind == Kind::Count && deltaEncode) {
+    columns.push_back({kind, Encoding::Delta, freq, n, utf8,
+                       [&history](QByteArray& buffer) {
+      qint64 prev = 0;
+      for (auto val : history) {
+        appendVarint(buffer, static_cast<qint64>(val) - prev);
+        prev = static_cast<qint64>(val);
+      }
+    }});
+  } else if (kind == Kind::Count) {
+    columns.push_back({kind, Encoding::Raw, freq, n, utf8,
+                       [&history](QByteArray& buffer) {
+      for (auto val : history) {
+        appendLE<qint64>(buffer, static_cast<qint64>(val));
+      }
+    }});
+  } else {
+    columns.push_back({kind, Encoding::Raw, freq, n, utf8,
+                       [&history, appendDouble](QByteArray& buffer) {
+      for (auto val : history) {
+        appendDouble(buffer, val);
+      }
+    }});
+  }
+
+  if (history.isComplete()) {
+    return;
+  }
+  columns.push_back({Kind::Rounds, Encoding::Raw, freq, n, utf8,
+                     [&history](QByteArray& buffer) {
+    for (unsigned int i = 0; i < history.size(); ++i) {
+      appendLE<qint64>(buffer, static_cast<qint64>(history.roundAt(i)));
+    }
+  }});
+  if (history.policy() == HistoryPolicy::Buckets) {
+    columns.push_back({Kind::Min, Encoding::Raw, freq, n, utf8,
+                       [&history, appendDouble](QByteArray& buffer) {
+      for (unsigned int i = 0; i < history.size(); ++i) {
+        appendDouble(buffer, history.minAt(i));
+      }
+    }});
+    columns.push_back({Kind::Max, Encoding::Raw, freq, n, utf8,
+                       [&history, appendDouble](QByteArray& buffer) {
+      for (unsigned int i = 0; i < history.size(); ++i) {
+        appendDouble(buffer, history.maxAt(i));
+      }
+    }});
+    columns.push_back({Kind::Mean, Encoding::Raw, freq, n, utf8,
+                       [&history, appendDouble](QByteArray& buffer) {
+      for (unsigned int i = 0; i < history.size(); ++i) {
+        appendDouble(buffer, history.meanAt(i));
+      }
+    }});
+  }
+}
+
+QByteArray MetricsFile::serialize(const std::vector<Count*>& counts,
+                                  const std::vector<Measure*>& measures,
+                                  bool deltaEncode) {
+  std::vector<ColumnSpec> columns;
+  for (const auto& c : counts) {
+    addHistoryColumns(columns, Kind::Count, deltaEncode, 1, c->_name,
+                      c->_history);
+  }
+  for (const auto& m : measures) {
+    addHistoryColumns(columns, Kind::Measure, deltaEncode, m->_freq, m->_name,
+                      m->_history);
+  }
+
+  // Header and column directory; the directory entries are filled in below
+  // once the offsets of the names and data are known.
+  QByteArray buffer;
+  buffer.append(magic, sizeof(magic));
+  appendLE<quint32>(buffer, formatVersion);
+  appendLE<quint32>(buffer, columns.size());
+  appendLE<quint64>(buffer, headerSize);
+  appendLE<quint64>(buffer, 0);
+  buffer.append(QByteArray(columnEntrySize * columns.size(), '\0'));
+
+  // String table holding the UTF-8 column names.
+  std::vector<quint32> nameOffsets;
+  for (const auto& col : columns) {
+    nameOffsets.push_back(buffer.size());
+    buffer.append(col.name);
+  }
+
+  // Column data, each array starting at an 8-byte aligned offset.
+  for (unsigned int i = 0; i < columns.size(); ++i) {
+    const ColumnSpec& col = columns[i];
+    padTo8(buffer);
+    const quint64 dataOffset = buffer.size();
+    col.writeData(buffer);
+
+    const int entry = headerSize + columnEntrySize * i;
+    buffer[entry] = static_cast<char>(col.kind);
+    buffer[entry + 1] = static_cast<char>(col.encoding);
+    writeLE<quint32>(buffer, entry + 4, col.freq);
+    writeLE<quint64>(buffer, entry + 8, col.numSamples);
+    writeLE<quint64>(buffer, entry + 16, dataOffset);
+    writeLE<quint64>(buffer, entry + 24, buffer.size() - dataOffset);
+    writeLE<quint32>(buffer, entry + 32, nameOffsets[i]);
+    writeLE<quint32>(buffer, entry + 36, col.name.size());
+  }
+
+  return buffer;
+}
+
+MetricsFile::MetricsFile(const QString filePath)
+  : _file(filePath),
+    _data(nullptr),
+    _size(0) {}
+
+MetricsFile::~MetricsFile() {
+  close();
+}
+
+bool MetricsFile::open() {
+  close();
+  if (!_file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  _size = _file.size();
+  if (_size < headerSize) {
+    close();
+    return false;
+  }
+  _data = _file.map(0, _size);
+  if (_data == nullptr || std::memcmp(_data, magic, sizeof(magic)) != 0
+      || readLE<quint32>(_data + 8) != formatVersion) {
+    close();
+    return false;
+  }
+
+  const quint32 numColumns = readLE<quint32>(_data + 12);
+  const quint64 directory = readLE<quint64>(_data + 16);
+  if (directory + static_cast<quint64>(columnEntrySize) * numColumns
+      > static_cast<quint64>(_size)) {
+    close();
+    return false;
+  }
+
+  for (quint32 i = 0; i < numColumns; ++i) {
+    const uchar* entry = _data + directory + columnEntrySize * i;
+    Column col;
+    col.kind = static_cast<Kind>(entry[0]);
+    col.encoding = static_cast<Encoding>(entry[1]);
+    col.freq = readLE<quint32>(entry + 4);
+    col.numSamples = readLE<quint64>(entry + 8);
+    col.dataOffset = readLE<quint64>(entry + 16);
+    col.dataSize = readLE<quint64>(entry + 24);
+    const quint32 nameOffset = readLE<quint32>(entry + 32);
+    const quint32 nameSize = readLE<quint32>(entry + 36);
+
+    const bool valid =
+        entry[0] <= static_cast<uchar>(Kind::Mean)
+        && (col.encoding == Encoding::Raw
+            || (col.encoding == Encoding::Delta && col.kind == Kind::Count))
+        && col.dataOffset + col.dataSize <= static_cast<quint64>(_size)
+        && static_cast<quint64>(nameOffset) + nameSize
+           <= static_cast<quint64>(_size)
+        && (col.encoding != Encoding::Raw
+            || (col.dataOffset % 8 == 0 && col.dataSize == 8 * col.numSamples));
+    if (!valid) {
+      close();
+      return false;
+    }
+
+    col.name = QString::fromUtf8(reinterpret_cast<const char*>(_data)
+                                 + nameOffset, nameSize);
+    _columns.push_back(col);
+  }
+
+  return true;
+}
+
+void MetricsFile::close() {
+  if (_data != nullptr) {
+    _file.unmap(const_cast<uchar*>(_data));
+    _data = nullptr;
+  }
+  if (_file.isOpen()) {
+    _file.close();
+  }
+  _size = 0;
+  _columns.clear();
+}
+
+bool MetricsFile::isOpen() const {
+  return _data != nullptr;
+}
+
+int MetricsFile::numColumns() const {
+  return _columns.size();
+}
+
+int MetricsFile::indexOf(const QString name, Kind kind) const {
+  for (unsigned int i = 0; i < _columns.size(); ++i) {
+    if (_columns[i].kind == kind
+        && QString::compare(_columns[i].name, name) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+QString MetricsFile::name(int column) const {
+  return _columns.at(column).name;
+}
+
+MetricsFile::Kind MetricsFile::kind(int column) const {
+  return _columns.at(column).kind;
+}
+
+MetricsFile::Encoding MetricsFile::encoding(int column) const {
+  return _columns.at(column).encoding;
+}
+
+unsigned int MetricsFile::frequency(int column) const {
+  return _columns.at(column).freq;
+}
+
+quint64 MetricsFile::numSamples(int column) const {
+  return _columns.at(column).numSamples;
+}
+
+bool MetricsFile::isIntegral(int column) const {
+  const Kind kind = _columns.at(column).kind;
+  return kind == Kind::Count || kind == Kind::Rounds;
+}
+
+const qint64* MetricsFile::countData(int column) const {
+  const Column& col = _columns.at(column);
+  if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN || !isIntegral(column)
+      || col.encoding != Encoding::Raw) {
+    return nullptr;
+  }
+
+  return reinterpret_cast<const qint64*>(_data + col.dataOffset);
+}
+
+const double* MetricsFile::measureData(int column) const {
+  const Column& col = _columns.at(column);
+  if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN || isIntegral(column)) {
+    return nullptr;
+  }
+
+  return reinterpret_cast<const double*>(_data + col.dataOffset);
+}
+
+std::vector<qint64> MetricsFile::countHistory(int column) const {
+  const Column& col = _columns.at(column);
+  std::vector<qint64> history;
+  if (!isIntegral(column)) {
+    return history;
+  }
+
+  history.reserve(col.numSamples);
+  const uchar* data = _data + col.dataOffset;
+  if (col.encoding == Encoding::Raw) {
+    for (quint64 i = 0; i < col.numSamples; ++i) {
+      history.push_back(readLE<qint64>(data + 8 * i));
+    }
+  } else {
+    const uchar* end = data + col.dataSize;
+    qint64 prev = 0;
+    while (data < end && history.size() < col.numSamples) {
+      quint64 zigzag = 0;
+      int shift = 0;
+      while (data < end && shift < 64) {
+        const uchar byte = *data++;
+        zigzag |= static_cast<quint64>(byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+          break;
+        }
+      }
+      const qint64 delta = static_cast<qint64>(zigzag >> 1) ^
+                           -static_cast<qint64>(zigzag & 1);
+      prev += delta;
+      history.push_back(prev);
+    }
+  }
+
+  return history;
+}
+
+std::vector<double> MetricsFile::measureHistory(int column) const {
+  const Column& col = _columns.at(column);
+  std::vector<double> history;
+  if (isIntegral(column)) {
+    return history;
+  }
+
+  history.reserve(col.numSamples);
+  const uchar* data = _data + col.dataOffset;
+  for (quint64 i = 0; i < col.numSamples; ++i) {
+    const quint64 bits = readLE<quint64>(data + 8 * i);
+    double val;
+    std::memcpy(&val, &bits, sizeof(val));
+    history.push_back(val);
+  }
+
+  return history;
+}
@@ -0,0 +1,132 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a columnar binary format for metrics histories and a memory-mapped
+// reader for it. Compared to the metrics JSON, these files are written without
+// any text formatting and can be loaded without parsing: each count or measure
+// history is stored as one contiguous array that the reader exposes directly
+// from the mapped file.
+//
+// Layout (all integers little-endian):
+//   Header (32 bytes):
+//     char[8]  magic "AMBMETRC"
+//     uint32   format version
+//     uint32   number of columns
+//     uint64   byte offset of the column directory
+//     uint64   reserved (zero)
+//   Column directory (48 bytes per column):
+//     uint8    kind (0 = count, 1 = measure, 2 = rounds, 3 = min, 4 = max,
+//              5 = mean)
+//     uint8    encoding (0 = raw array, 1 = delta-encoded varints)
+//     uint16   reserved (zero)
+//     uint32   frequency in rounds
+//     uint64   number of samples
+//     uint64   byte offset of the column data
+//     uint64   byte size of the column data
+//     uint32   byte offset of the column name
+//     uint32   byte size of the column name (UTF-8)
+// Raw count and rounds columns are arrays of int64 and raw measure, min, max,
+// and mean columns are arrays of float64, each starting at an 8-byte aligned
+// offset. Histories that do not retain every sample (see HistoryPolicy in
+// metric.h) are followed by a rounds column with the same name holding the
+// round of each retained sample and, for bucketed histories, by min, max, and
+// mean columns holding the bucket aggregates. Delta-encoded columns store the
+// zigzag LEB128 varint of each difference to the previous sample (the first
+// sample is stored as its difference to zero) and are only used for counts,
+// whose histories are nondecreasing and compress very well this way.
+
+#ifndef AMOEBOTSIM_CORE_METRICSFILE_H_
+#define AMOEBOTSIM_CORE_METRICSFILE_H_
+
+#include <vector>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/metric.h"
+
+class MetricsFile {
+ public:
+  enum class Kind : quint8 {
+    Count = 0,
+    Measure = 1,
+    Rounds = 2,
+    Min = 3,
+    Max = 4,
+    Mean = 5
+  };
+
+  enum class Encoding : quint8 {
+    Raw = 0,
+    Delta = 1
+  };
+
+  // Serializes the given counts and measures into the binary metrics format.
+  // If deltaEncode is true, count histories are delta-encoded; measure
+  // histories are always stored as raw arrays.
+  static QByteArray serialize(const std::vector<Count*>& counts,
+                              const std::vector<Measure*>& measures,
+                              bool deltaEncode = false);
+
+  // Constructs a reader for the binary metrics file at the given path. The
+  // file is not touched until open() is called.
+  explicit MetricsFile(const QString filePath);
+  ~MetricsFile();
+
+  // Maps the file into memory and validates its header and column directory.
+  // Returns false (leaving the reader closed) if the file cannot be mapped or
+  // is not a well-formed metrics file. close() unmaps the file.
+  bool open();
+  void close();
+  bool isOpen() const;
+
+  // Column metadata. Columns appear in the order in which they were written,
+  // i.e., all counts followed by all measures, each directly followed by its
+  // auxiliary columns (if any). indexOf returns the index of the first column
+  // of the given kind with the given name, or -1 if there is no such column.
+  int numColumns() const;
+  int indexOf(const QString name, Kind kind) const;
+  QString name(int column) const;
+  Kind kind(int column) const;
+  Encoding encoding(int column) const;
+  unsigned int frequency(int column) const;
+  quint64 numSamples(int column) const;
+
+  // Returns true if the column holds int64 values (counts and rounds) and false
+  // if it holds float64 values (measures and aggregates).
+  bool isIntegral(int column) const;
+
+  // Zero-copy access to raw columns. countData (resp., measureData) returns a
+  // pointer directly into the mapped file holding numSamples() values, or
+  // nullptr if the column is not a raw integral (resp., floating point) column
+  // or the host is not little-endian. The pointer is valid until close().
+  const qint64* countData(int column) const;
+  const double* measureData(int column) const;
+
+  // Copying access that works for every column regardless of its encoding.
+  // countHistory decodes an integral column and measureHistory copies a
+  // floating point column; both return an empty vector for the other columns.
+  std::vector<qint64> countHistory(int column) const;
+  std::vector<double> measureHistory(int column) const;
+
+ private:
+  struct Column {
+    Kind kind;
+    Encoding encoding;
+    unsigned int freq;
+    quint64 numSamples;
+    quint64 dataOffset;
+    quint64 dataSize;
+    QString name;
+  };
+
+  QFile _file;
+  const uchar* _data;
+  qint64 _size;
+  std::vector<Column> _columns;
+};
+
+#endif  // AMOEBOTSIM_CORE_METRICSFILE_H_
@@ -10,6 +10,7 @@
 #define AMOEBOTSIM_CORE_NODE_H_
 
 #include <array>
+#include <functional>
 
 #include <QtGlobal>
 
@@ -37,7 +38,6 @@ class Node {
 // case of a tie, compares their y-coordinates.
 bool operator<(const Node& v1, const Node& v2);
 
-
 inline Node::Node()
   : x(0), y(0) {}
 
@@ -68,4 +68,15 @@ inline bool operator<(const Node& v1, const Node& v2) {
   return (v1.x < v2.x) || (v1.x == v2.x && v1.y < v2.y);
 }
 
+// Allows nodes to be used as keys of unordered containers.
+namespace std {
+template<>
+struct hash<Node> {
+  size_t operator()(const Node& node) const {
+    const quint64 x = static_cast<quint32>(node.x);
+    return hash<quint64>()((x << 32) | static_cast<quint32>(node.y));
+  }
+};
+}  // namespace std
+
 #endif  // AMOEBOTSIM_CORE_NODE_H_
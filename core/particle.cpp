@@ -60,3 +60,7 @@ std::array<int, 6> Particle::borderPointColors() const {
 QString Particle::inspectionText() const {
   return "Overwrite Particle::inspectionText() to specify an inspection text.";
 }
+
+int Particle::stateIndex() const {
+  return -1;
+}
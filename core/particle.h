@@ -52,6 +52,12 @@ class Particle {
   // to snapshot the current values of this particle's memory at runtime.
   virtual QString inspectionText() const;
 
+  // Returns an algorithm-defined index of the particle's state, usually the
+  // position of its state in the algorithm's State enum, so that scripts can
+  // analyze states without parsing inspection texts. The default is -1, which
+  // indicates that the algorithm does not export its states.
+  virtual int stateIndex() const;
+
   Node head;
   int globalTailDir;
 };
@@ -4,17 +4,29 @@
 
 #include "core/simulator.h"
 
+#include <algorithm>
+
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QMutexLocker>
 #include <QTextStream>
+#include <QThread>
 #include <QtGlobal>
 
 #include "core/metric.h"
 
-Simulator::Simulator() {
+thread_local int Simulator::clearedStops = 0;
+
+Simulator::Simulator()
+  : historyPolicy(HistoryPolicy::Full),
+    historyCapacity(0),
+    historyRatio(2.0),
+    numStops(0),
+    shuttingDown(0),
+    telemetrySnapshotMs(5000) {
   stepTimer.setInterval(100);
   connect(&stepTimer, &QTimer::timeout, this, &Simulator::step);
 }
@@ -24,33 +36,128 @@ Simulator::~Simulator() {
 }
 
 void Simulator::setSystem(std::shared_ptr<System> _system) {
+  // Scripts must not continue until the system is set, so calls from their
+  // thread wait for the GUI thread to set it.
+  if (QThread::currentThread() != thread()) {
+    onGuiThread([this, _system]() { setSystem(_system); });
+    return;
+  }
+
   stepTimer.stop();
   emit stopped();
 
-  system = _system;
+  {
+    // Scripts may change the history policy from their thread meanwhile.
+    QMutexLocker settingsLocker(&settingsMutex);
+    std::atomic_store(&system, _system);
+    if (historyPolicy != HistoryPolicy::Full) {
+      system->setHistoryPolicy(historyPolicy, historyCapacity, historyRatio);
+    }
+  }
   emit systemChanged(system);
 }
 
 std::shared_ptr<System> Simulator::getSystem() const {
-  return system;
+  return std::atomic_load(&system);
+}
+
+void Simulator::setHistoryPolicy(HistoryPolicy policy, unsigned int capacity,
+                                 double ratio) {
+  QMutexLocker settingsLocker(&settingsMutex);
+  historyPolicy = policy;
+  historyCapacity = capacity;
+  historyRatio = ratio;
+  std::shared_ptr<System> system = getSystem();
+  if (system != nullptr) {
+    QMutexLocker locker(&system->mutex);
+    system->setHistoryPolicy(policy, capacity, ratio);
+  }
+}
+
+bool Simulator::setTelemetry(const QString key, int snapshotMs) {
+  std::shared_ptr<TelemetryWriter> writer;
+  if (!key.isEmpty()) {
+    writer = std::make_shared<TelemetryWriter>(key);
+    if (!writer->isValid()) {
+      return false;
+    }
+  }
+  // Bulk runs read both, so wait for one in progress to finish.
+  QMutexLocker runLocker(&runMutex);
+  telemetrySnapshotMs = snapshotMs;
+  std::atomic_store(&telemetry, writer);
+  return true;
+}
+
+bool Simulator::isInterrupted() const {
+  return numStops.load() != clearedStops || shuttingDown.load() != 0;
+}
+
+void Simulator::clearInterrupt() {
+  clearedStops = numStops.load();
+}
+
+bool Simulator::onGuiThread(const std::function<void()>& function) {
+  if (QThread::currentThread() == thread()) {
+    function();
+    return true;
+  }
+
+  // The function may refer to the caller's stack, so it runs under the mutex
+  // and only if the caller is still waiting for it.
+  struct Call {
+    bool done;
+    bool cancelled;
+  };
+  std::shared_ptr<Call> call = std::make_shared<Call>(Call{false, false});
+  QMutexLocker locker(&guiCallMutex);
+  if (shuttingDown.load() != 0) {
+    return false;
+  }
+  QMetaObject::invokeMethod(this, [this, call, function]() {
+    QMutexLocker locker(&guiCallMutex);
+    if (!call->cancelled) {
+      function();
+      call->done = true;
+      guiCallDone.wakeAll();
+    }
+  }, Qt::QueuedConnection);
+  while (!call->done && shuttingDown.load() == 0) {
+    guiCallDone.wait(&guiCallMutex);
+  }
+  call->cancelled = !call->done;
+  return call->done;
+}
+
+void Simulator::shutDown() {
+  QMutexLocker locker(&guiCallMutex);
+  shuttingDown.store(1);
+  guiCallDone.wakeAll();
 }
 
 void Simulator::start() {
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(this, [this]() { start(); },
+                              Qt::QueuedConnection);
+    return;
+  }
+
   stepTimer.start();
   emit started();
 }
 
 void Simulator::stop() {
-  stepTimer.stop();
-  emit stopped();
+  numStops.fetchAndAddOrdered(1);
+  halt();
 }
 
 void Simulator::step() {
+  std::shared_ptr<System> system = getSystem();
   QMutexLocker locker(&system->mutex);
   system->activate();
 
   if (system->hasTerminated()) {
-    stop();
+    halt();
   }
 }
 
@@ -60,28 +167,156 @@ void Simulator::stepForParticleAt(Node node) {
 }
 
 void Simulator::setStepDuration(int ms) {
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(this, [this, ms]() { setStepDuration(ms); },
+                              Qt::QueuedConnection);
+    return;
+  }
+
   stepTimer.setInterval(ms);
   emit stepDurationChanged(ms);
 }
 
 void Simulator::runUntilTermination() {
+  run(0, QString(), 0);
+}
+
+Simulator::RunResult Simulator::stepN(quint64 n) {
+  if (n == 0) {
+    return RunResult{0, 0, 0, false};
+  }
+  return run(n, QString(), 0);
+}
+
+Simulator::RunResult Simulator::runRounds(quint64 k) {
+  return run(0, "# Rounds", k);
+}
+
+Simulator::RunResult Simulator::runUntil(RunCondition condition,
+                                         quint64 budget) {
+  switch (condition) {
+    case RunCondition::Round:
+      return run(budget, "# Rounds", 1);
+    case RunCondition::Move:
+      return run(budget, "# Moves", 1);
+    default:
+      // Termination is checked by every run.
+      return run(budget, QString(), 0);
+  }
+}
+
+Simulator::RunResult Simulator::run(quint64 budget, const QString countName,
+                                    quint64 increase) {
+  // The mutex is released about once per frame so that the window can draw
+  // the system and show its metrics while a script runs.
+  static constexpr qint64 lockMs = 16;
+  static constexpr qint64 progressMs = 500;
+
+  QMutexLocker runLocker(&runMutex);
+  if (isInterrupted()) {
+    return RunResult{0, 0, 0, false};
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  qint64 lockedSince = 0;
+  qint64 lastProgress = 0;
+  qint64 lastSnapshot = -telemetrySnapshotMs;
+  bool wasInterrupted = false;
+
+  std::shared_ptr<TelemetryWriter> writer = std::atomic_load(&telemetry);
+  std::shared_ptr<System> system = getSystem();
   QMutexLocker locker(&system->mutex);
-  while (!system->hasTerminated()) {
+  const Count& rounds = system->getCount("# Rounds");
+  const Count* count = countName.isEmpty() ? nullptr
+                                           : &system->getCount(countName);
+  const quint64 startRound = rounds._value;
+  const quint64 target = (count != nullptr) ? count->_value + increase : 0;
+  RunResult result{0, 0, 0, system->hasTerminated()};
+  while (!result.terminated && (budget == 0 || result.steps < budget)
+         && (count == nullptr || count->_value < target)) {
     system->activate();
+    ++result.steps;
+    result.terminated = system->hasTerminated();
+
+    if (result.steps % 256 == 0 && timer.elapsed() - lockedSince >= lockMs) {
+      result.rounds = rounds._value - startRound;
+      const qint64 now = timer.elapsed();
+      const bool report = (now - lastProgress >= progressMs);
+
+      // Telemetry only copies what it needs while the system is locked and
+      // compresses snapshots after unlocking it.
+      QByteArray positions;
+      if (report && writer != nullptr) {
+        writer->publishSample(*system, result.steps, rounds._value,
+                              1000.0 * result.steps / now);
+        if (now - lastSnapshot >= telemetrySnapshotMs) {
+          positions = TelemetryWriter::capturePositions(*system);
+          lastSnapshot = now;
+        }
+      }
+      locker.unlock();
+      if (!positions.isEmpty()) {
+        writer->publishSnapshot(positions);
+      }
+      if (isInterrupted()) {
+        wasInterrupted = true;
+        break;
+      }
+      if (report) {
+        emit progress(result.steps, result.rounds, 1000.0 * result.steps / now);
+        lastProgress = now;
+      }
+      locker.relock();
+      lockedSince = timer.elapsed();
+    }
   }
+  QByteArray positions;
+  if (!wasInterrupted) {
+    result.rounds = rounds._value - startRound;
+    if (writer != nullptr) {
+      writer->publishSample(*system, result.steps, rounds._value,
+                            1000.0 * result.steps
+                            / std::max(qint64(1), timer.elapsed()));
+      positions = TelemetryWriter::capturePositions(*system);
+    }
+    locker.unlock();
+  }
+  if (!positions.isEmpty()) {
+    writer->publishSnapshot(positions);
+  }
+
+  if (result.terminated) {
+    halt();
+  }
+  result.ms = timer.elapsed();
+  return result;
+}
+
+void Simulator::halt() {
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(this, [this]() { halt(); }, Qt::QueuedConnection);
+    return;
+  }
+
+  stepTimer.stop();
+  emit stopped();
 }
 
 int Simulator::numParticles() const {
+  std::shared_ptr<System> system = getSystem();
   QMutexLocker locker(&system->mutex);
   return system->size();
 }
 
 int Simulator::numObjects() const {
+  std::shared_ptr<System> system = getSystem();
   QMutexLocker locker(&system->mutex);
   return system->numObjects();
 }
 
 QVariant Simulator::metrics() const {
+  std::shared_ptr<System> system = getSystem();
   QMutexLocker locker(&system->mutex);
   QList<QVariant> metricsData;
   for (const auto& c : system->getCounts()) {
@@ -97,7 +332,14 @@ QVariant Simulator::metrics() const {
   return QVariant::fromValue(metricsData);
 }
 
-void Simulator::exportMetrics() {
+bool Simulator::exportMetrics(const QString format) {
+  const bool isJSON = (format == "json");
+  const bool isBinary = (format == "binary" || format == "binary-delta");
+  if (!isJSON && !isBinary) {
+    return false;
+  }
+
+  std::shared_ptr<System> system = getSystem();
   QMutexLocker locker(&system->mutex);
   QDir metricsDir(QCoreApplication::applicationDirPath());
   #ifdef Q_OS_MACOS
@@ -108,13 +350,23 @@ void Simulator::exportMetrics() {
     metricsDir.cd("metrics");
   }
   QFile outFile(metricsDir.path() + "/metrics_" +
-                QString::number(QDateTime::currentSecsSinceEpoch()) + ".json");
-  if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-    return;
+                QString::number(QDateTime::currentSecsSinceEpoch()) +
+                (isJSON ? ".json" : ".bin"));
+  if (isJSON) {
+    if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+      return false;
+    }
+    QTextStream outStream(&outFile);
+    outStream << system->metricsAsJSON();
+  } else {
+    if (!outFile.open(QIODevice::WriteOnly)) {
+      return false;
+    }
+    outFile.write(system->metricsAsBinary(format == "binary-delta"));
   }
-  QTextStream outStream(&outFile);
-  outStream << system->metricsAsJSON();
   outFile.close();
+
+  return true;
 }
 
 void Simulator::saveScreenshotSetup(const QString filePath) {
@@ -5,24 +5,74 @@
 #ifndef AMOEBOTSIM_CORE_SIMULATOR_H_
 #define AMOEBOTSIM_CORE_SIMULATOR_H_
 
+#include <functional>
 #include <memory>
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QObject>
+#include <QString>
 #include <QTimer>
 #include <QVariant>
+#include <QWaitCondition>
 
+#include "core/metric.h"
 #include "core/system.h"
+#include "core/telemetry.h"
 
 class Simulator : public QObject {
   Q_OBJECT
 
  public:
+  // The outcome of a bulk run: the number of activations executed, the number
+  // of asynchronous rounds completed during them, the wall-clock time taken,
+  // and whether the run ended because the system terminated.
+  struct RunResult {
+    quint64 steps;
+    quint64 rounds;
+    qint64 ms;
+    bool terminated;
+  };
+
+  // The conditions a bulk run can wait for: termination of the system, the
+  // completion of the current round, or the next particle movement.
+  enum class RunCondition { Terminated, Round, Move };
+
   Simulator();
   virtual ~Simulator();
 
   void setSystem(std::shared_ptr<System> _system);
   std::shared_ptr<System> getSystem() const;
 
+  // Sets the retention policy of the metric histories of the current system
+  // and of every system set afterwards. See metric.h for the parameters.
+  void setHistoryPolicy(HistoryPolicy policy, unsigned int capacity = 0,
+                        double ratio = 2.0);
+
+  // Publishes telemetry of bulk runs under the given shared memory key (see
+  // telemetry.h), or stops publishing if the key is empty: a sample whenever
+  // progress is reported and a snapshot of the particles' positions every
+  // snapshotMs milliseconds. Returns false if the memory cannot be created.
+  // Waits for a bulk run of another thread to finish.
+  bool setTelemetry(const QString key, int snapshotMs = 5000);
+
+  // Functions for bulk runs on other threads. A stop interrupts the bulk runs
+  // of every thread, and a thread's later bulk runs return right away until it
+  // calls clearInterrupt, which it does when it starts something new on behalf
+  // of the GUI or a client (e.g., a script). isInterrupted tells whether the
+  // calling thread has a stop it has not cleared. After shutDown, every
+  // thread is interrupted for good.
+  bool isInterrupted() const;
+  void clearInterrupt();
+
+  // Functions for calling into the GUI thread from other threads. onGuiThread
+  // runs the given function on the GUI thread and waits for it. shutDown is
+  // called on the GUI thread before it waits for other threads to finish;
+  // afterwards, waiting and future onGuiThread calls return false without
+  // running their functions, so they cannot deadlock with the GUI thread.
+  bool onGuiThread(const std::function<void()>& function);
+  void shutDown();
+
  signals:
   void systemChanged(std::shared_ptr<System> _system);
   void stepDurationChanged(int ms);
@@ -31,12 +81,21 @@ class Simulator : public QObject {
   void started();
   void stopped();
 
+  // Emitted about twice a second during bulk runs with the number of
+  // activations executed and rounds completed so far and the activations per
+  // second.
+  void progress(quint64 steps, quint64 rounds, double stepsPerSecond);
+
  public slots:
   // Responds to control flow signals from the GUI and scripts. Start, stop, and
-  // step are self-explanatory. stepForParticleAt executes one activation for
-  // the specific particle at the given node. setStepDuration updates the delay
-  // in milliseconds between particle activations. runUntilTermination activates
+  // step are self-explanatory; stop also interrupts a running bulk run (see
+  // below). stepForParticleAt executes one activation for the specific
+  // particle at the given node. setStepDuration updates the delay in
+  // milliseconds between particle activations. runUntilTermination activates
   // particles repeatedly until the hasTerminated condition is satisfied.
+  // Scripts call these from their own thread; setSystem then waits until the
+  // system is set on the GUI thread, and the step timer is only ever touched
+  // there.
   void start();
   void stop();
   void step();
@@ -44,6 +103,18 @@ class Simulator : public QObject {
   void setStepDuration(int ms);
   void runUntilTermination();
 
+  // Bulk stepping for scripts, which execute many activations without a call
+  // into the script engine per activation. The system's mutex is only released
+  // about once per frame so the window can draw. Every run stops early if the
+  // system terminates or stop is called, and reports its progress. stepN
+  // executes n activations. runRounds executes activations until k more rounds
+  // have completed. runUntil executes activations until the given condition
+  // holds or budget activations have been executed; a budget of 0 is
+  // unlimited.
+  RunResult stepN(quint64 n);
+  RunResult runRounds(quint64 k);
+  RunResult runUntil(RunCondition condition, quint64 budget);
+
   // Responds to GUI and script requests for statistics and metrics.
   int numParticles() const;
   int numObjects() const;
@@ -51,16 +122,52 @@ class Simulator : public QObject {
 
   // Responds to the exportMetrics signal from the GUI and scripts by creating
   // an output file with a unique timestamp (to avoid accidental overwrites) and
-  // writing the metrics JSON to it.
-  void exportMetrics();
+  // writing the metrics to it. The format is either "json" (the default),
+  // "binary" for the columnar binary format described in metricsfile.h, or
+  // "binary-delta" for the same format with delta-encoded count histories.
+  // Returns false if the format is unknown or the file could not be written.
+  bool exportMetrics(const QString format = "json");
 
   // Emits a signal that updates the system visually, followed by a signal that
   // takes a screenshot of the result.
   void saveScreenshotSetup(const QString filePath);
 
  protected:
+  // Executes activations until the system terminates, budget activations have
+  // been executed (if budget is positive), or the count with the given name
+  // (if any) has increased by the given amount. Must be called without holding
+  // the system's mutex. Runs from different threads execute one at a time.
+  RunResult run(quint64 budget, const QString countName, quint64 increase);
+
+  // Stops the step timer on the GUI thread without interrupting bulk runs.
+  void halt();
+
   QTimer stepTimer;
   std::shared_ptr<System> system;
+
+  // The history policy applied to every system that is set. Scripts set it
+  // from their own thread, so it is guarded by settingsMutex.
+  QMutex settingsMutex;
+  HistoryPolicy historyPolicy;
+  unsigned int historyCapacity;
+  double historyRatio;
+
+  // The number of stops so far, and the number the calling thread has
+  // cleared; see isInterrupted.
+  QAtomicInt numStops;
+  static thread_local int clearedStops;
+
+  // Guards calls into the GUI thread; see onGuiThread.
+  QMutex guiCallMutex;
+  QWaitCondition guiCallDone;
+  QAtomicInt shuttingDown;
+
+  // Held by bulk runs, which share the interrupt and the telemetry writer, and
+  // by setTelemetry.
+  QMutex runMutex;
+
+  std::shared_ptr<TelemetryWriter> telemetry;
+  int telemetrySnapshotMs;
 };
 
 #endif  // AMOEBOTSIM_CORE_SIMULATOR_H_
@@ -4,6 +4,14 @@
 
 #include "core/system.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent>
+
 SystemIterator::SystemIterator(const System* system, int pos)
   : _pos(pos)
   , system(system) {}
@@ -21,6 +29,10 @@ const SystemIterator& SystemIterator::operator++() {
   return *this;
 }
 
+System::System()
+  : _journalReset(true),
+    _revision(0) {}
+
 SystemIterator System::begin() const {
   return SystemIterator(this, 0);
 }
@@ -32,3 +44,150 @@ SystemIterator System::end() const {
 bool System::hasTerminated() const {
   return false;
 }
+
+std::vector<quint64> System::stateHistogram() const {
+  return histogram([](const System&, const Particle& p,
+                      std::vector<quint64>& counts) {
+    const int state = p.stateIndex();
+    if (state >= 0) {
+      if (counts.size() <= static_cast<unsigned int>(state)) {
+        counts.resize(state + 1, 0);
+      }
+      ++counts[state];
+    }
+  });
+}
+
+quint64 System::countInState(int state) const {
+  const std::vector<quint64> counts = stateHistogram();
+  return (state >= 0 && static_cast<unsigned int>(state) < counts.size())
+      ? counts[state] : 0;
+}
+
+std::vector<quint64> System::degreeHistogram() const {
+  return histogram([](const System& system, const Particle& p,
+                      std::vector<quint64>& counts) {
+    // A particle has at most 8 neighbors (if it is expanded), so duplicates
+    // are found with a linear scan.
+    std::array<const Particle*, 10> nbrs;
+    unsigned int degree = 0;
+    const int numNodes = p.isExpanded() ? 2 : 1;
+    for (int i = 0; i < numNodes; ++i) {
+      const Node node = (i == 0) ? p.head : p.tail();
+      for (int dir = 0; dir < 6; ++dir) {
+        const Particle* nbr = system.particleAt(node.nodeInDir(dir));
+        if (nbr != nullptr && nbr != &p
+            && std::find(nbrs.begin(), nbrs.begin() + degree, nbr)
+               == nbrs.begin() + degree) {
+          nbrs[degree++] = nbr;
+        }
+      }
+    }
+    if (counts.size() <= degree) {
+      counts.resize(degree + 1, 0);
+    }
+    ++counts[degree];
+  });
+}
+
+quint64 System::countInRegion(const Node& center, int radius) const {
+  if (radius < 0) {
+    return 0;
+  }
+
+  // The ball of the given radius lies within the same range of both axial
+  // coordinates, where the distance is (|dx| + |dy| + |dx + dy|) / 2.
+  std::vector<const Particle*> candidates;
+  particlesInRange(center.x - radius, center.x + radius,
+                   center.y - radius, center.y + radius, candidates);
+  quint64 count = 0;
+  for (const Particle* p : candidates) {
+    const int dx = p->head.x - center.x, dy = p->head.y - center.y;
+    if (std::abs(dx) + std::abs(dy) + std::abs(dx + dy) <= 2 * radius) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+int System::revision() const {
+  return _revision.load();
+}
+
+bool System::takeChanges(std::vector<const Particle*>& changed) {
+  const bool complete = !_journalReset;
+  changed.clear();
+  changed.swap(_journal);
+  _journaled.clear();
+  _journalReset = false;
+
+  return complete;
+}
+
+void System::invalidateChanges() {
+  journalReset();
+}
+
+void System::journalChange(const Particle* particle) {
+  if (_journalReset) {
+    return;
+  }
+
+  if (_journaled.insert(particle).second) {
+    _journal.push_back(particle);
+    if (_journal.size() > size() / 4) {
+      journalReset();
+      return;
+    }
+  }
+  _revision.ref();
+}
+
+void System::journalReset() {
+  _journal.clear();
+  _journaled.clear();
+  _journalReset = true;
+  _revision.ref();
+}
+
+bool System::isJournalReset() const {
+  return _journalReset;
+}
+
+std::vector<quint64> System::histogram(
+    void (*add)(const System&, const Particle&, std::vector<quint64>&)) const {
+  // Below a few thousand particles, starting threads costs more than it saves.
+  static const unsigned int minChunkSize = 4096;
+  const unsigned int numParticles = size();
+  const unsigned int numChunks = std::max(1u, std::min(
+      static_cast<unsigned int>(QThread::idealThreadCount()),
+      numParticles / minChunkSize));
+  auto addRange = [this, add](unsigned int first, unsigned int last) {
+    std::vector<quint64> counts;
+    for (unsigned int i = first; i < last; ++i) {
+      add(*this, at(i), counts);
+    }
+    return counts;
+  };
+  if (numChunks == 1) {
+    return addRange(0, numParticles);
+  }
+
+  std::vector<QFuture<std::vector<quint64>>> futures;
+  for (unsigned int chunk = 0; chunk < numChunks; ++chunk) {
+    const unsigned int first = chunk * numParticles / numChunks;
+    const unsigned int last = (chunk + 1) * numParticles / numChunks;
+    futures.push_back(QtConcurrent::run(addRange, first, last));
+  }
+  std::vector<quint64> counts;
+  for (QFuture<std::vector<quint64>>& future : futures) {
+    const std::vector<quint64> partial = future.result();
+    if (counts.size() < partial.size()) {
+      counts.resize(partial.size(), 0);
+    }
+    for (unsigned int i = 0; i < partial.size(); ++i) {
+      counts[i] += partial[i];
+    }
+  }
+  return counts;
+}
@@ -10,8 +10,14 @@
 
 #include <deque>
 #include <set>
+#include <unordered_set>
+#include <vector>
 
+#include <QAtomicInt>
+#include <QByteArray>
 #include <QMutex>
+#include <QPointF>
+#include <QRectF>
 #include <QString>
 
 #include "core/metric.h"
@@ -43,6 +49,9 @@ class SystemIterator {
 
 class System {
  public:
+  // Constructs a system with an empty change journal.
+  System();
+
   // Signatures for functions which activate particles. Must be overridden by
   // any system subclasses; see amoebotsystem.h for more detailed documentation.
   virtual void activate() = 0;
@@ -62,6 +71,38 @@ class System {
   // Returns a reference to the object list.
   virtual const std::deque<Object*>& getObjects() const = 0;
 
+  // Spatial queries over the lattice. particleAt returns the particle occupying
+  // the given node with its head or tail, or nullptr if the node is unoccupied.
+  // particlesInRange appends the particles whose heads lie in the given range
+  // of lattice coordinates (bounds inclusive) to the given vector. Must be
+  // overridden by any system subclasses; see amoebotsystem.h for their costs.
+  virtual const Particle* particleAt(const Node& node) const = 0;
+  virtual void particlesInRange(int xMin, int xMax, int yMin, int yMax,
+                                std::vector<const Particle*>& result) const = 0;
+
+  // Aggregates of the nodes occupied by particles (heads and tails) and
+  // objects, in world coordinates. centerOfMass returns the centroid of these
+  // nodes and boundingBox the bounding rectangle of their centers; both are
+  // meaningless if the system is empty. Must be overridden by any system
+  // subclasses; see amoebotsystem.h for their costs.
+  virtual QPointF centerOfMass() const = 0;
+  virtual QRectF boundingBox() const = 0;
+
+  // Aggregates of the particles' states and neighborhoods in the current
+  // configuration, computed on several threads for large systems.
+  // stateHistogram returns the number of particles in each state, indexed by
+  // Particle::stateIndex (particles without a state are not counted), and
+  // countInState the number in the given state. degreeHistogram returns the
+  // number of particles with d neighboring particles at index d, where a
+  // neighbor occupies a node adjacent to the particle's head or tail.
+  // countInRegion returns the number of particles whose heads are at most the
+  // given number of lattice steps away from the given node; it only visits the
+  // particles near that node, using particlesInRange.
+  std::vector<quint64> stateHistogram() const;
+  quint64 countInState(int state) const;
+  std::vector<quint64> degreeHistogram() const;
+  quint64 countInRegion(const Node& center, int radius) const;
+
   // STL-like begin and end functions for particle-accessing iterators.
   SystemIterator begin() const;
   SystemIterator end() const;
@@ -73,16 +114,55 @@ class System {
   virtual Count& getCount(QString name) const = 0;
   virtual Measure& getMeasure(QString name) const = 0;
   virtual const QString metricsAsJSON() const = 0;
+  virtual const QByteArray metricsAsBinary(bool deltaEncode = false) const = 0;
+  virtual void setHistoryPolicy(HistoryPolicy policy, unsigned int capacity = 0,
+                                double ratio = 2.0) = 0;
 
   virtual bool hasTerminated() const;
 
+  // Functions for consuming the change journal, which records the particles
+  // whose position or appearance may have changed so that the visualization
+  // only has to update those. revision returns a number that changes whenever
+  // a change is recorded; it can be read without locking the system's mutex.
+  // takeChanges moves the recorded particles into the given vector and clears
+  // the journal. It returns false if the journal was reset because too many
+  // or structural changes (e.g., insertions) happened since the last call, in
+  // which case everything must be considered changed. invalidateChanges resets
+  // the journal; the journal has a single consumer, so anything else that takes
+  // changes (e.g., a rendering benchmark) must call it afterwards to make the
+  // visualization redraw everything.
+  int revision() const;
+  bool takeChanges(std::vector<const Particle*>& changed);
+  void invalidateChanges();
+
  protected:
+  // Functions for recording changes in the journal. journalChange records that
+  // the given particle may have changed, and journalReset records that the
+  // whole system may have changed. Once the journal holds more than a quarter
+  // of the particles, it resets itself and ignores further changes until it is
+  // consumed, so recording is cheap while the visualization falls behind.
+  void journalChange(const Particle* particle);
+  void journalReset();
+  bool isJournalReset() const;
+
+  // Computes a histogram over all particles by adding each particle to a
+  // histogram with the given function, splitting the particles among several
+  // threads if there are many.
+  std::vector<quint64> histogram(
+      void (*add)(const System&, const Particle&, std::vector<quint64>&)) const;
+
   // Checks whether the particle system forms one connected component.
   template<class ParticleContainer>
   static bool isConnected(const ParticleContainer& particles);
 
  public:
   QMutex mutex;
+
+ private:
+  std::vector<const Particle*> _journal;
+  std::unordered_set<const Particle*> _journaled;
+  bool _journalReset;
+  QAtomicInt _revision;
 };
 
 template<class ParticleContainer>
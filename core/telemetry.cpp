@@ -0,0 +1,243 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/telemetry.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Telemetry;
+
+TelemetryWriter::TelemetryWriter(const QString& key, int ringCapacity,
+                                 int snapshotCapacity)
+    : memory(key) {
+  ringCapacity = std::max(1, ringCapacity);
+  snapshotCapacity = std::max(0, snapshotCapacity);
+  const int size = sizeof(Header) + ringCapacity * sizeof(Slot)
+                   + snapshotCapacity;
+  if (!memory.create(size)
+      && memory.error() == QSharedMemory::AlreadyExists) {
+    // On Unix, the memory of a crashed writer outlives it until the last
+    // process detaches from it, which this does unless a reader is attached.
+    if (memory.attach()) {
+      memory.detach();
+    }
+    memory.create(size);
+  }
+  if (!memory.isAttached()) {
+    return;
+  }
+
+  std::memset(memory.data(), 0, memory.size());
+  Header* h = header();
+  h->magic = magic;
+  h->version = version;
+  h->ringCapacity = ringCapacity;
+  h->snapshotCapacity = snapshotCapacity;
+  h->numSamples.store(0);
+  h->snapshotSequence.store(0);
+  timer.start();
+}
+
+bool TelemetryWriter::isValid() const {
+  return memory.isAttached();
+}
+
+QString TelemetryWriter::errorString() const {
+  return memory.errorString();
+}
+
+void TelemetryWriter::publishSample(const System& system, quint64 steps,
+                                    quint64 rounds, double stepsPerSecond) {
+  if (!isValid()) {
+    return;
+  }
+
+  Header* h = header();
+  const quint64 index = h->numSamples.load(std::memory_order_relaxed);
+  Slot& slot = ring()[index % h->ringCapacity];
+  const quint64 sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  Sample& sample = slot.sample;
+  sample.ms = timer.elapsed();
+  sample.steps = steps;
+  sample.rounds = rounds;
+  sample.stepsPerSecond = stepsPerSecond;
+  sample.numParticles = system.size();
+  sample.numMetrics = 0;
+  auto addMetric = [&sample](const QString& name, double value) {
+    if (sample.numMetrics < static_cast<quint32>(maxMetrics)) {
+      const QByteArray utf8 = name.toUtf8().left(maxNameLength - 1);
+      char* dest = sample.names[sample.numMetrics];
+      std::memset(dest, 0, maxNameLength);
+      std::memcpy(dest, utf8.constData(), utf8.size());
+      sample.values[sample.numMetrics++] = value;
+    }
+  };
+  for (const Count* c : system.getCounts()) {
+    addMetric(c->_name, c->_value);
+  }
+  for (const Measure* m : system.getMeasures()) {
+    addMetric(m->_name, m->_history.empty() ? 0.0 : m->_history.back());
+  }
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  h->numSamples.store(index + 1, std::memory_order_release);
+}
+
+QByteArray TelemetryWriter::capturePositions(const System& system) {
+  const unsigned int numParticles = system.size();
+  QByteArray positions((1 + 4 * numParticles) * sizeof(qint32),
+                       Qt::Uninitialized);
+  qint32* values = reinterpret_cast<qint32*>(positions.data());
+  *values++ = numParticles;
+  for (unsigned int i = 0; i < numParticles; ++i) {
+    const Particle& p = system.at(i);
+    *values++ = p.head.x;
+    *values++ = p.head.y;
+    *values++ = p.globalTailDir;
+    *values++ = p.headMarkColor();
+  }
+  return positions;
+}
+
+void TelemetryWriter::publishSnapshot(const QByteArray& positions) {
+  if (!isValid()) {
+    return;
+  }
+
+  // Positions of nearby particles are similar, so even the fastest level of
+  // compression shrinks snapshots considerably.
+  const QByteArray compressed = qCompress(positions, 1);
+  Header* h = header();
+  if (static_cast<quint32>(compressed.size()) > h->snapshotCapacity) {
+    return;
+  }
+
+  const quint64 sequence =
+      h->snapshotSequence.load(std::memory_order_relaxed);
+  h->snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  h->snapshotSize = compressed.size();
+  std::memcpy(snapshotData(), compressed.constData(), compressed.size());
+  h->snapshotSequence.store(sequence + 2, std::memory_order_release);
+}
+
+Header* TelemetryWriter::header() {
+  return static_cast<Header*>(memory.data());
+}
+
+Slot* TelemetryWriter::ring() {
+  return reinterpret_cast<Slot*>(static_cast<char*>(memory.data())
+                                 + sizeof(Header));
+}
+
+char* TelemetryWriter::snapshotData() {
+  return reinterpret_cast<char*>(ring() + header()->ringCapacity);
+}
+
+TelemetryReader::TelemetryReader(const QString& key)
+    : memory(key) {}
+
+bool TelemetryReader::attach() {
+  if (!memory.attach(QSharedMemory::ReadOnly)) {
+    error = memory.errorString();
+    return false;
+  }
+
+  const Header* h = header();
+  if (static_cast<size_t>(memory.size()) < sizeof(Header)
+      || h->magic != magic || h->version != version
+      || static_cast<size_t>(memory.size()) < sizeof(Header)
+         + h->ringCapacity * sizeof(Slot) + h->snapshotCapacity) {
+    error = "Unknown telemetry format";
+    memory.detach();
+    return false;
+  }
+  return true;
+}
+
+QString TelemetryReader::errorString() const {
+  return error;
+}
+
+void TelemetryReader::samples(quint64& next,
+                              std::vector<Sample>& result) const {
+  if (!memory.isAttached()) {
+    return;
+  }
+
+  const Header* h = header();
+  const quint64 numSamples = h->numSamples.load(std::memory_order_acquire);
+  if (numSamples - std::min(next, numSamples) > h->ringCapacity) {
+    next = numSamples - h->ringCapacity;  // Older samples are overwritten.
+  }
+  for (; next < numSamples; ++next) {
+    const Slot& slot = ring()[next % h->ringCapacity];
+    // A slot being written is skipped after a few attempts; the writer never
+    // waits for readers.
+    for (int attempt = 0; attempt < 4; ++attempt) {
+      const quint64 before = slot.sequence.load(std::memory_order_acquire);
+      if (before % 2 == 1) {
+        continue;
+      }
+      Sample sample;
+      std::memcpy(&sample, &slot.sample, sizeof(Sample));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == before) {
+        result.push_back(sample);
+        break;
+      }
+    }
+  }
+}
+
+bool TelemetryReader::snapshot(quint64& sequence,
+                               std::vector<SnapshotParticle>& particles) const {
+  if (!memory.isAttached()) {
+    return false;
+  }
+
+  const Header* h = header();
+  const quint64 before = h->snapshotSequence.load(std::memory_order_acquire);
+  if (before == sequence || before % 2 == 1
+      || h->snapshotSize > h->snapshotCapacity) {
+    return false;
+  }
+  const QByteArray compressed(snapshotData(), h->snapshotSize);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (h->snapshotSequence.load(std::memory_order_relaxed) != before) {
+    return false;  // Overwritten while copying; try again later.
+  }
+
+  const QByteArray positions = qUncompress(compressed);
+  qint32 numParticles = 0;
+  if (positions.size() < static_cast<int>(sizeof(qint32))) {
+    return false;
+  }
+  std::memcpy(&numParticles, positions.constData(), sizeof(qint32));
+  const size_t size = numParticles * sizeof(SnapshotParticle);
+  if (numParticles < 0 || positions.size() - sizeof(qint32) < size) {
+    return false;
+  }
+  particles.resize(numParticles);
+  std::memcpy(particles.data(), positions.constData() + sizeof(qint32), size);
+  sequence = before;
+  return true;
+}
+
+const Header* TelemetryReader::header() const {
+  return static_cast<const Header*>(memory.constData());
+}
+
+const Slot* TelemetryReader::ring() const {
+  return reinterpret_cast<const Slot*>(
+      static_cast<const char*>(memory.constData()) + sizeof(Header));
+}
+
+const char* TelemetryReader::snapshotData() const {
+  return reinterpret_cast<const char*>(ring() + header()->ringCapacity);
+}
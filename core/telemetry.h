@@ -0,0 +1,140 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a live telemetry channel in shared memory, through which a running
+// simulation can be observed by other local processes, e.g., a headless run by
+// a simulator window attached to it (see ui/telemetryviewer.h) or a dashboard.
+// The writer publishes samples of the run's throughput and metric values into
+// a ring buffer and, less often, compressed snapshots of the particles'
+// positions. Readers map the memory read-only and never block the writer:
+// every slot is guarded by a sequence number that is odd while the slot is
+// written, so readers copy a slot and retry if its sequence number changed.
+//
+// The memory holds a Header followed by Header::ringCapacity Slots and a
+// snapshot area of Header::snapshotCapacity bytes. A snapshot, once
+// uncompressed with qUncompress, is a sequence of native 32-bit integers: the
+// number of particles followed by head x, head y, global tail direction, and
+// head mark color per particle.
+
+#ifndef AMOEBOTSIM_CORE_TELEMETRY_H_
+#define AMOEBOTSIM_CORE_TELEMETRY_H_
+
+#include <atomic>
+#include <vector>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSharedMemory>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/system.h"
+
+namespace Telemetry {
+
+constexpr quint32 magic = 0x414d5454;  // "AMTT".
+constexpr quint32 version = 1;
+constexpr int maxMetrics = 16;
+constexpr int maxNameLength = 32;
+
+struct Header {
+  quint32 magic;
+  quint32 version;
+  quint32 ringCapacity;
+  quint32 snapshotCapacity;
+  std::atomic<quint64> numSamples;  // Sample i is in slot i % ringCapacity.
+  std::atomic<quint64> snapshotSequence;
+  quint32 snapshotSize;
+};
+
+// A sample of a run: the time since the writer was created, the activations
+// executed and rounds completed, the activations per second, the number of
+// particles, and the names and current values of the system's counts and
+// measures (up to maxMetrics of them).
+struct Sample {
+  qint64 ms;
+  quint64 steps;
+  quint64 rounds;
+  double stepsPerSecond;
+  quint32 numParticles;
+  quint32 numMetrics;
+  char names[maxMetrics][maxNameLength];
+  double values[maxMetrics];
+};
+
+struct Slot {
+  std::atomic<quint64> sequence;
+  Sample sample;
+};
+
+}  // namespace Telemetry
+
+class TelemetryWriter {
+ public:
+  // Creates the shared memory with the given key, holding the last ringCapacity
+  // samples and snapshots of up to snapshotCapacity compressed bytes. If the
+  // memory cannot be created, isValid returns false and errorString says why.
+  TelemetryWriter(const QString& key, int ringCapacity = 256,
+                  int snapshotCapacity = 16 << 20);
+
+  bool isValid() const;
+  QString errorString() const;
+
+  // Publishes a sample of the given system, which must be locked by the
+  // caller. This copies less than a kilobyte.
+  void publishSample(const System& system, quint64 steps, quint64 rounds,
+                     double stepsPerSecond);
+
+  // Functions for publishing snapshots. capturePositions copies the particles'
+  // positions and colors from the given system, which must be locked by the
+  // caller. publishSnapshot compresses them and publishes the result; it does
+  // not need the system, so it can run after the system is unlocked. Snapshots
+  // that do not fit are dropped.
+  static QByteArray capturePositions(const System& system);
+  void publishSnapshot(const QByteArray& positions);
+
+ private:
+  Telemetry::Header* header();
+  Telemetry::Slot* ring();
+  char* snapshotData();
+
+  QSharedMemory memory;
+  QElapsedTimer timer;
+};
+
+class TelemetryReader {
+ public:
+  // A particle in a snapshot.
+  struct SnapshotParticle {
+    qint32 x, y;
+    qint32 globalTailDir;
+    qint32 color;
+  };
+
+  explicit TelemetryReader(const QString& key);
+
+  // Maps the memory of the writer with the given key read-only. Returns false
+  // if there is no such writer or its format is unknown.
+  bool attach();
+  QString errorString() const;
+
+  // Appends the samples published since sample number next (or the oldest
+  // ones still held) to the given vector and advances next past them.
+  void samples(quint64& next, std::vector<Telemetry::Sample>& result) const;
+
+  // Reads the latest snapshot if its sequence number differs from the given
+  // one, which is updated. Returns false if there is no new snapshot.
+  bool snapshot(quint64& sequence,
+                std::vector<SnapshotParticle>& particles) const;
+
+ private:
+  const Telemetry::Header* header() const;
+  const Telemetry::Slot* ring() const;
+  const char* snapshotData() const;
+
+  QSharedMemory memory;
+  QString error;
+};
+
+#endif  // AMOEBOTSIM_CORE_TELEMETRY_H_
@@ -0,0 +1,102 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "core/topologymeasure.h"
+
+#include <set>
+
+#include "core/particle.h"
+
+EulerCharacteristicMeasure::EulerCharacteristicMeasure(
+    const QString name, const unsigned int freq, const AmoebotSystem& system)
+    : IncrementalMeasure(name, freq),
+      _system(system),
+      _numVertices(0),
+      _numEdges(0),
+      _numFaces(0) {}
+
+void EulerCharacteristicMeasure::initialize() {
+  std::set<Node> nodes;
+  for (const Particle& p : _system) {
+    nodes.insert(p.head);
+    if (p.isExpanded()) {
+      nodes.insert(p.tail());
+    }
+  }
+
+  // Every edge and face is incident to its nodes, so summing over all nodes
+  // counts every edge twice and every face three times.
+  _numVertices = nodes.size();
+  _numEdges = 0;
+  _numFaces = 0;
+  for (const Node& node : nodes) {
+    _numEdges += numIncidentEdges(node);
+    _numFaces += numIncidentFaces(node);
+  }
+  _numEdges /= 2;
+  _numFaces /= 3;
+}
+
+void EulerCharacteristicMeasure::nodeOccupied(const Node& node) {
+  ++_numVertices;
+  _numEdges += numIncidentEdges(node);
+  _numFaces += numIncidentFaces(node);
+}
+
+void EulerCharacteristicMeasure::nodeVacated(const Node& node) {
+  // The node is already unoccupied, but its neighbors are unchanged, so its
+  // incident edges and faces are counted as if it were still occupied.
+  --_numVertices;
+  _numEdges -= numIncidentEdges(node);
+  _numFaces -= numIncidentFaces(node);
+}
+
+double EulerCharacteristicMeasure::calculate() const {
+  return eulerCharacteristic();
+}
+
+qint64 EulerCharacteristicMeasure::eulerCharacteristic() const {
+  return _numVertices - _numEdges + _numFaces;
+}
+
+qint64 EulerCharacteristicMeasure::numVertices() const {
+  return _numVertices;
+}
+
+int EulerCharacteristicMeasure::numIncidentEdges(const Node& node) const {
+  int numEdges = 0;
+  for (int dir = 0; dir < 6; ++dir) {
+    if (_system.isOccupied(node.nodeInDir(dir))) {
+      ++numEdges;
+    }
+  }
+
+  return numEdges;
+}
+
+int EulerCharacteristicMeasure::numIncidentFaces(const Node& node) const {
+  // The six faces around a node are spanned by its neighbors in consecutive
+  // directions.
+  bool occupied[6];
+  for (int dir = 0; dir < 6; ++dir) {
+    occupied[dir] = _system.isOccupied(node.nodeInDir(dir));
+  }
+
+  int numFaces = 0;
+  for (int dir = 0; dir < 6; ++dir) {
+    if (occupied[dir] && occupied[(dir + 1) % 6]) {
+      ++numFaces;
+    }
+  }
+
+  return numFaces;
+}
+
+double HoleCountMeasure::calculate() const {
+  return (numVertices() == 0) ? 0 : 1 - eulerCharacteristic();
+}
+
+double BoundaryCountMeasure::calculate() const {
+  return (numVertices() == 0) ? 0 : 2 - eulerCharacteristic();
+}
@@ -0,0 +1,77 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines measures of the topology of a particle system, i.e., the number of
+// holes and boundaries of the set of occupied nodes, that any algorithm can add
+// to its AmoebotSystem. Instead of flood-filling the unoccupied nodes, these
+// maintain the number of vertices V, edges E, and triangular faces F of the
+// subgraph of the triangular lattice induced by the occupied nodes. Occupying
+// or vacating a node changes these by at most 1, 6, and 6, respectively, which
+// can be counted by looking at the node's neighbors only. The Euler
+// characteristic V - E + F of this planar graph equals its number of connected
+// components minus its number of holes, where a hole is a bounded region of
+// unoccupied nodes enclosed by particles.
+
+#ifndef AMOEBOTSIM_CORE_TOPOLOGYMEASURE_H_
+#define AMOEBOTSIM_CORE_TOPOLOGYMEASURE_H_
+
+#include <QString>
+#include <QtGlobal>
+
+#include "core/amoebotsystem.h"
+#include "core/metric.h"
+#include "core/node.h"
+
+class EulerCharacteristicMeasure : public IncrementalMeasure {
+ public:
+  // Constructs a measure of the Euler characteristic of the nodes occupied by
+  // the given system's particles, with a given name and calculation frequency.
+  EulerCharacteristicMeasure(const QString name, const unsigned int freq,
+                             const AmoebotSystem& system);
+
+  // Counts the vertices, edges, and faces from scratch and updates them in O(1)
+  // time whenever a node is occupied or vacated.
+  void initialize() final;
+  void nodeOccupied(const Node& node) final;
+  void nodeVacated(const Node& node) final;
+
+  // Calculates the Euler characteristic V - E + F. Child classes derive the
+  // number of holes and boundaries from it.
+  double calculate() const override;
+
+  // Returns the current Euler characteristic and number of occupied nodes.
+  qint64 eulerCharacteristic() const;
+  qint64 numVertices() const;
+
+ protected:
+  // Returns the number of edges (resp., triangular faces) of the occupied
+  // subgraph incident to the given node, assuming it is occupied.
+  int numIncidentEdges(const Node& node) const;
+  int numIncidentFaces(const Node& node) const;
+
+  const AmoebotSystem& _system;
+  qint64 _numVertices, _numEdges, _numFaces;
+};
+
+class HoleCountMeasure : public EulerCharacteristicMeasure {
+ public:
+  using EulerCharacteristicMeasure::EulerCharacteristicMeasure;
+
+  // Calculates the number of holes in the system, assuming its particles are
+  // connected (otherwise, this is the number of holes minus the number of
+  // components plus one).
+  double calculate() const final;
+};
+
+class BoundaryCountMeasure : public EulerCharacteristicMeasure {
+ public:
+  using EulerCharacteristicMeasure::EulerCharacteristicMeasure;
+
+  // Calculates the number of boundaries of the system, i.e., its outer boundary
+  // plus the boundary of each of its holes, assuming its particles are
+  // connected.
+  double calculate() const final;
+};
+
+#endif  // AMOEBOTSIM_CORE_TOPOLOGYMEASURE_H_
@@ -4,4 +4,5 @@
 
 #include "helper/randomnumbergenerator.h"
 
-std::mt19937 RandomNumberGenerator::rng;
+thread_local std::mt19937 RandomNumberGenerator::rng;
+thread_local bool RandomNumberGenerator::initialized = false;
@@ -9,11 +9,19 @@
 #include <chrono>
 #include <random>
 
+// Every thread has its own generator, so that systems can be simulated on
+// several threads at once. A thread's generator is seeded randomly when the
+// first RandomNumberGenerator is constructed on it, unless it was seeded
+// explicitly before.
 class RandomNumberGenerator
 {
 public:
     RandomNumberGenerator();
 
+    // Seeds the calling thread's generator, making the random choices of
+    // systems constructed and simulated on this thread reproducible.
+    static void seed(const uint32_t seed);
+
 protected:
     static int randInt(const int from, const int toNotIncluding);
     static int randDir();
@@ -25,12 +33,12 @@ protected:
     void shuffle(Iterator firxt, Iterator last);
 
 private:
-    static std::mt19937 rng;
+    static thread_local std::mt19937 rng;
+    static thread_local bool initialized;
 };
 
 inline RandomNumberGenerator::RandomNumberGenerator()
 {
-    static bool initialized = false;
     if(!initialized) {
         uint32_t seed;
         std::random_device device;
@@ -47,6 +55,12 @@ inline RandomNumberGenerator::RandomNumberGenerator()
     }
 }
 
+inline void RandomNumberGenerator::seed(const uint32_t seed)
+{
+    rng.seed(seed);
+    initialized = true;
+}
+
 inline int RandomNumberGenerator::randInt(const int from, const int toNotIncluding)
 {
     std::uniform_int_distribution<int> dist(from, toNotIncluding - 1);
@@ -9,6 +9,7 @@
 #include <QString>
 #include <QStringList>
 
+#include "ui/telemetryviewer.h"
 #include "ui/visitem.h"
 
 Application::Application(int argc, char *argv[])
@@ -51,7 +52,10 @@ Application::Application(int argc, char *argv[])
     connect(alg, &Algorithm::log, [qmlRoot](const QString msg, const bool isError){
       QMetaObject::invokeMethod(qmlRoot, "log", Q_ARG(QVariant, msg), Q_ARG(QVariant, isError));
     });
-    connect(alg, &Algorithm::setSystem, &sim, &Simulator::setSystem);
+    // Scripts instantiate algorithms on their own thread and must wait until
+    // the new system is set, which Simulator::setSystem takes care of.
+    connect(alg, &Algorithm::setSystem, &sim, &Simulator::setSystem,
+            Qt::DirectConnection);
   }
 
   // setup connections between GUI and Simulator
@@ -71,6 +75,14 @@ Application::Application(int argc, char *argv[])
             QMetaObject::invokeMethod(qmlRoot, "setLabelStart");
           }
   );
+  connect(&sim, &Simulator::progress,
+          [qmlRoot](quint64 steps, quint64 rounds, double stepsPerSecond){
+            const QString msg = QString("%1 activations, %2 rounds (%3 per second)")
+                                    .arg(steps).arg(rounds)
+                                    .arg(qRound64(stepsPerSecond));
+            QMetaObject::invokeMethod(qmlRoot, "log", Q_ARG(QVariant, msg), Q_ARG(QVariant, false));
+          }
+  );
   connect(vis, &VisItem::stepForParticleAt, &sim, &Simulator::stepForParticleAt);
   connect(slider, SIGNAL(stepDurationChanged(int)), &sim, SLOT(setStepDuration(int)));
   connect(&sim, &Simulator::stepDurationChanged,
@@ -87,6 +99,35 @@ Application::Application(int argc, char *argv[])
           }
   );
 
+  // "--attach <key>" shows a simulation running in another process instead of
+  // a local system; see ui/telemetryviewer.h.
+  const QStringList args = arguments();
+  const int attachIndex = args.indexOf("--attach");
+  if (attachIndex != -1 && attachIndex + 1 < args.size()) {
+    telemetryViewer = std::make_shared<TelemetryViewer>(args[attachIndex + 1]);
+    connect(telemetryViewer.get(), &TelemetryViewer::setSystem,
+            &sim, &Simulator::setSystem);
+    connect(telemetryViewer.get(), &TelemetryViewer::log,
+            [qmlRoot](const QString msg, const bool isError){
+              QMetaObject::invokeMethod(qmlRoot, "log", Q_ARG(QVariant, msg), Q_ARG(QVariant, isError));
+            }
+    );
+    telemetryViewer->attach();
+  }
+
+  // "--serve <name>" lets other processes drive the simulator through a local
+  // socket; see script/commandserver.h.
+  const int serveIndex = args.indexOf("--serve");
+  if (serveIndex != -1 && serveIndex + 1 < args.size()) {
+    commandServer = std::make_shared<CommandServer>(
+        sim, parameterModel->getAlgorithmList());
+    if (!commandServer->listen(args[serveIndex + 1])) {
+      const QString msg = "Cannot serve commands: "
+                          + commandServer->errorString();
+      QMetaObject::invokeMethod(qmlRoot, "log", Q_ARG(QVariant, msg), Q_ARG(QVariant, true));
+    }
+  }
+
   // Set default step duration.
   sim.setStepDuration(0);
 }
@@ -11,8 +11,10 @@
 #include <QQmlApplicationEngine>
 
 #include "core/simulator.h"
+#include "script/commandserver.h"
 #include "script/scriptengine.h"
 #include "ui/parameterlistmodel.h"
+#include "ui/telemetryviewer.h"
 
 class Application : public QGuiApplication {
   Q_OBJECT
@@ -23,6 +25,8 @@ class Application : public QGuiApplication {
   QQmlApplicationEngine engine;
   Simulator sim;
   std::shared_ptr<ScriptEngine> scriptEngine;
+  std::shared_ptr<CommandServer> commandServer;
+  std::shared_ptr<TelemetryViewer> telemetryViewer;
   ParameterListModel* parameterModel;
 };
 
@@ -17,9 +17,31 @@
  *
  * AmoebotSim is developed using Open Source Qt. */
 
+#include <cstring>
+
+#include <QCoreApplication>
+
 #include "application.h"
+#include "script/distributedsweep.h"
+#include "ui/algorithm.h"
 
 int main(int argc, char *argv[]) {
+  // "--sweep-worker <address>" runs a headless worker for a distributed sweep
+  // (see script/distributedsweep.h) instead of the simulator's window.
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (std::strcmp(argv[i], "--sweep-worker") == 0) {
+      QCoreApplication app(argc, argv);
+      AlgorithmList algList;
+      SweepWorker worker(algList);
+      QObject::connect(&worker, &SweepWorker::finished,
+                       &app, &QCoreApplication::quit, Qt::QueuedConnection);
+      if (!worker.connectTo(QString(argv[i + 1]))) {
+        return 1;
+      }
+      return app.exec();
+    }
+  }
+
   Application app(argc, argv);
   return app.exec();
 }
@@ -99,6 +99,9 @@ ApplicationWindow {
         } else if (event.key === Qt.Key_F) {
           vis.focusOnCenterOfMass()
           event.accepted = true
+        } else if (event.key === Qt.Key_Z) {
+          vis.zoomToFit()
+          event.accepted = true
         }
       }
     }
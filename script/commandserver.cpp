@@ -0,0 +1,341 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "script/commandserver.h"
+
+#include <QByteArray>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include "core/telemetry.h"
+#include "helper/randomnumbergenerator.h"
+
+namespace {
+
+// The largest request accepted. Requests only hold commands and their
+// arguments, so anything larger comes from a broken or hostile client.
+constexpr quint32 maxRequestSize = 16 << 20;
+
+enum class Opcode : quint8 {
+  Instantiate = 1,
+  StepN = 2,
+  RunRounds = 3,
+  RunUntil = 4,
+  Metrics = 5,
+  Snapshot = 6,
+  Checkpoint = 7,
+  Restore = 8
+};
+
+enum class Status : quint8 {
+  Ok = 0,
+  Error = 1,
+  Skipped = 2
+};
+
+// Functions for reading and writing strings and string lists in UTF-8.
+QString readString(QDataStream& in) {
+  QByteArray utf8;
+  in >> utf8;
+  return QString::fromUtf8(utf8);
+}
+
+void writeString(QDataStream& out, const QString& string) {
+  out << string.toUtf8();
+}
+
+QStringList readStringList(QDataStream& in) {
+  quint32 size = 0;
+  in >> size;
+  QStringList list;
+  for (quint32 i = 0; i < size && in.status() == QDataStream::Ok; ++i) {
+    list.append(readString(in));
+  }
+  return list;
+}
+
+// Reads past the arguments of a command that is skipped because an earlier
+// command of its batch failed. Unknown opcodes corrupt the stream, since the
+// size of their arguments is unknown.
+void skipArguments(Opcode opcode, QDataStream& in) {
+  QByteArray string;
+  QStringList values;
+  quint8 condition;
+  quint32 seedOrId;
+  quint64 n;
+  switch (opcode) {
+    case Opcode::Instantiate:
+      in >> string;
+      values = readStringList(in);
+      in >> seedOrId;
+      break;
+    case Opcode::StepN:
+    case Opcode::RunRounds:
+      in >> n;
+      break;
+    case Opcode::RunUntil:
+      in >> condition >> n;
+      break;
+    case Opcode::Metrics:
+    case Opcode::Snapshot:
+    case Opcode::Checkpoint:
+      break;
+    case Opcode::Restore:
+      in >> seedOrId;
+      break;
+    default:
+      in.setStatus(QDataStream::ReadCorruptData);
+  }
+}
+
+}  // namespace
+
+CommandServer::CommandServer(Simulator& sim, AlgorithmList* algList)
+    : sim(sim),
+      algList(algList),
+      server(nullptr),
+      current{QString(), QStringList(), 0, 0} {
+  moveToThread(&thread);
+  thread.start();
+}
+
+CommandServer::~CommandServer() {
+  // Interrupt any bulk run or replay and any call into this (the GUI) thread
+  // the server thread is waiting for, then tear the server down on its own
+  // thread once that has returned to its event loop.
+  sim.shutDown();
+  if (server != nullptr) {
+    server->deleteLater();
+  }
+  thread.quit();
+  thread.wait();
+}
+
+bool CommandServer::listen(const QString& name) {
+  if (QThread::currentThread() != &thread) {
+    bool ok = false;
+    QMetaObject::invokeMethod(this, [this, name, &ok]() {
+      ok = listen(name);
+    }, Qt::BlockingQueuedConnection);
+    return ok;
+  }
+
+  if (server == nullptr) {
+    server = new QLocalServer(this);
+    connect(server, &QLocalServer::newConnection,
+            this, &CommandServer::accept);
+  }
+  // A stale socket file of a crashed simulator would block the name.
+  QLocalServer::removeServer(name);
+  if (!server->listen(name)) {
+    error = server->errorString();
+    return false;
+  }
+  return true;
+}
+
+QString CommandServer::errorString() const {
+  return error;
+}
+
+void CommandServer::accept() {
+  while (QLocalSocket* socket = server->nextPendingConnection()) {
+    connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+      receive(socket);
+    });
+    connect(socket, &QLocalSocket::disconnected,
+            socket, &QLocalSocket::deleteLater);
+  }
+}
+
+void CommandServer::receive(QLocalSocket* socket) {
+  while (true) {
+    uchar header[4];
+    if (socket->peek(reinterpret_cast<char*>(header), sizeof(header))
+        < static_cast<qint64>(sizeof(header))) {
+      return;
+    }
+    const quint32 size = qFromBigEndian<quint32>(header);
+    if (size > maxRequestSize) {
+      socket->abort();
+      return;
+    } else if (socket->bytesAvailable()
+               < static_cast<qint64>(sizeof(header) + size)) {
+      return;
+    }
+    socket->skip(sizeof(header));
+    const QByteArray request = socket->read(size);
+
+    QDataStream in(request);
+    in.setVersion(QDataStream::Qt_5_0);
+    QByteArray reply;
+    QDataStream out(&reply, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << quint32(0);  // The frame's length, filled in below.
+    executeBatch(in, out);
+    if (in.status() != QDataStream::Ok) {
+      socket->abort();  // A malformed request leaves the stream out of sync.
+      return;
+    }
+    qToBigEndian<quint32>(reply.size() - sizeof(quint32), reply.data());
+    socket->write(reply);
+  }
+}
+
+void CommandServer::executeBatch(QDataStream& in, QDataStream& out) {
+  // Each batch starts anew after the stop button interrupted an earlier one.
+  sim.clearInterrupt();
+
+  quint32 batchId = 0;
+  quint16 numCommands = 0;
+  in >> batchId >> numCommands;
+  out << batchId << numCommands;
+
+  bool failed = false;
+  for (quint16 i = 0; i < numCommands && in.status() == QDataStream::Ok;
+       ++i) {
+    quint8 opcode = 0;
+    in >> opcode;
+    if (failed) {
+      skipArguments(static_cast<Opcode>(opcode), in);
+      out << quint8(Status::Skipped);
+      continue;
+    }
+
+    QByteArray result;
+    QDataStream resultOut(&result, QIODevice::WriteOnly);
+    resultOut.setVersion(QDataStream::Qt_5_0);
+    const QString message = execute(opcode, in, resultOut);
+    if (message.isEmpty()) {
+      out << quint8(Status::Ok);
+      out.writeRawData(result.constData(), result.size());
+    } else {
+      out << quint8(Status::Error);
+      writeString(out, message);
+      failed = true;
+    }
+  }
+}
+
+QString CommandServer::execute(quint8 opcode, QDataStream& in,
+                               QDataStream& out) {
+  switch (static_cast<Opcode>(opcode)) {
+    case Opcode::Instantiate: {
+      Checkpoint checkpoint;
+      checkpoint.signature = readString(in);
+      checkpoint.values = readStringList(in);
+      in >> checkpoint.seed;
+      checkpoint.steps = 0;
+      if (in.status() != QDataStream::Ok) {
+        return "Malformed request";
+      }
+      const QString message = rebuild(checkpoint);
+      if (message.isEmpty()) {
+        out << quint32(sim.numParticles());
+      }
+      return message;
+    }
+    case Opcode::StepN:
+    case Opcode::RunRounds: {
+      quint64 n = 0;
+      in >> n;
+      if (in.status() != QDataStream::Ok) {
+        return "Malformed request";
+      }
+      runResult((static_cast<Opcode>(opcode) == Opcode::StepN)
+                ? sim.stepN(n) : sim.runRounds(n), out);
+      return QString();
+    }
+    case Opcode::RunUntil: {
+      quint8 condition = 0;
+      quint64 budget = 0;
+      in >> condition >> budget;
+      if (in.status() != QDataStream::Ok) {
+        return "Malformed request";
+      } else if (condition > 2) {
+        return "Unknown condition";
+      }
+      static const Simulator::RunCondition conditions[] = {
+        Simulator::RunCondition::Terminated,
+        Simulator::RunCondition::Round,
+        Simulator::RunCondition::Move
+      };
+      runResult(sim.runUntil(conditions[condition], budget), out);
+      return QString();
+    }
+    case Opcode::Metrics:
+    case Opcode::Snapshot: {
+      std::shared_ptr<System> active = sim.getSystem();
+      if (active == nullptr) {
+        return "No system has been instantiated";
+      }
+      QMutexLocker locker(&active->mutex);
+      if (static_cast<Opcode>(opcode) == Opcode::Metrics) {
+        out << active->metricsAsBinary();
+      } else {
+        out << TelemetryWriter::capturePositions(*active);
+      }
+      return QString();
+    }
+    case Opcode::Checkpoint: {
+      if (system == nullptr || sim.getSystem() != system) {
+        return "Only systems instantiated by this server can be checkpointed";
+      }
+      out << quint32(checkpoints.size());
+      checkpoints.push_back(current);
+      return QString();
+    }
+    case Opcode::Restore: {
+      quint32 id = 0;
+      in >> id;
+      if (in.status() != QDataStream::Ok) {
+        return "Malformed request";
+      } else if (id >= checkpoints.size()) {
+        return "Unknown checkpoint";
+      }
+      const QString message = rebuild(checkpoints[id]);
+      if (message.isEmpty()) {
+        out << quint32(sim.numParticles());
+      }
+      return message;
+    }
+    default:
+      // The arguments of an unknown command cannot be skipped.
+      in.setStatus(QDataStream::ReadCorruptData);
+      return "Unknown opcode " + QString::number(opcode);
+  }
+}
+
+QString CommandServer::rebuild(const Checkpoint& checkpoint) {
+  Algorithm* alg = algList->getAlgBySignature(checkpoint.signature);
+  if (alg == nullptr) {
+    return "Unknown algorithm \"" + checkpoint.signature + "\"";
+  }
+
+  RandomNumberGenerator::seed(checkpoint.seed);
+  std::shared_ptr<System> newSystem = alg->createSystem(checkpoint.values);
+  if (newSystem == nullptr) {
+    return "Invalid parameters for " + checkpoint.signature;
+  }
+  for (quint64 i = 0; i < checkpoint.steps; ++i) {
+    if (sim.isInterrupted()) {
+      return "Interrupted while replaying the checkpoint";
+    }
+    newSystem->activate();
+  }
+
+  system = newSystem;
+  current = checkpoint;
+  sim.setSystem(system);
+  return QString();
+}
+
+void CommandServer::runResult(const Simulator::RunResult& result,
+                              QDataStream& out) {
+  if (system != nullptr && sim.getSystem() == system) {
+    current.steps += result.steps;
+  }
+  out << quint64(result.steps) << quint64(result.rounds) << qint64(result.ms)
+      << quint8(result.terminated ? 1 : 0);
+}
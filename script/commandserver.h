@@ -0,0 +1,125 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Lets other processes drive the simulator through a local socket (a Unix
+// domain socket or a Windows named pipe) with a compact binary protocol, as
+// scripts do through ScriptInterface but without a script per command. The
+// simulator listens when started with "AmoebotSim --serve <name>" (see
+// main/application.h). Commands are executed in order on a dedicated thread,
+// in batches, so a client can send many commands at once and wait for a
+// single reply.
+//
+// All integers are big-endian. A string is a 32-bit length followed by that
+// many bytes of UTF-8, a string list is a 32-bit count followed by that many
+// strings, and a byte array is a 32-bit length followed by that many bytes.
+// Both requests and replies are framed by a 32-bit length of what follows.
+//
+// A request holds a 32-bit batch id, a 16-bit number of commands, and the
+// commands, each an 8-bit opcode followed by its arguments:
+//   1 instantiate  string signature, string list values, 32-bit seed
+//   2 stepN        64-bit number of activations
+//   3 runRounds    64-bit number of rounds
+//   4 runUntil     8-bit condition (0 terminated, 1 round, 2 move),
+//                  64-bit budget (0 for none)
+//   5 metrics
+//   6 snapshot
+//   7 checkpoint
+//   8 restore      32-bit checkpoint id
+// A reply holds the batch id, the number of commands, and a result for every
+// command: an 8-bit status (0 ok, 1 error, 2 skipped because an earlier
+// command of the batch failed) followed, on error, by a message string or,
+// if ok, by:
+//   instantiate, restore        32-bit number of particles
+//   stepN, runRounds, runUntil  64-bit activations, 64-bit rounds completed,
+//                               64-bit milliseconds, 8-bit terminated flag
+//   metrics                     byte array in the binary metrics format of
+//                               core/metricsfile.h
+//   snapshot                    byte array of native 32-bit integers as in
+//                               core/telemetry.h (uncompressed)
+//   checkpoint                  32-bit checkpoint id
+// A request that is cut short, has an unknown opcode, or is longer than 16 MiB
+// closes the connection, since the commands following it cannot be found.
+//
+// Instantiating seeds the server thread's random number generator, and all
+// activations of the system then happen on that thread, so a system is
+// determined by its algorithm, parameter values, seed, and number of
+// activations. A checkpoint records these, and restoring it rebuilds the
+// system by replaying its activations instead of storing algorithm-specific
+// particle memory. Checkpoints are therefore only possible while the system
+// instantiated by the server is activated by nobody else, e.g., the window.
+
+#ifndef AMOEBOTSIM_SCRIPT_COMMANDSERVER_H_
+#define AMOEBOTSIM_SCRIPT_COMMANDSERVER_H_
+
+#include <memory>
+#include <vector>
+
+#include <QDataStream>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+#include "core/simulator.h"
+#include "core/system.h"
+#include "ui/algorithm.h"
+
+class CommandServer : public QObject {
+  Q_OBJECT
+
+ public:
+  // Starts the server thread. The CommandServer itself lives on that thread.
+  CommandServer(Simulator& sim, AlgorithmList* algList);
+
+  // Interrupts any bulk run and stops the server thread. Must be called on the
+  // GUI thread, which the server thread may be waiting for.
+  ~CommandServer();
+
+  // Listens on the local socket with the given name. Returns false and sets
+  // errorString if the name cannot be used. Can be called from any thread.
+  bool listen(const QString& name);
+  QString errorString() const;
+
+ private:
+  // Everything needed to rebuild a system; see above.
+  struct Checkpoint {
+    QString signature;
+    QStringList values;
+    quint32 seed;
+    quint64 steps;
+  };
+
+  // Functions for handling clients. receive executes the complete requests
+  // a client has sent, and executeBatch executes one of them, writing the
+  // reply to out. execute executes a single command, returning an error
+  // message or an empty string on success.
+  void accept();
+  void receive(QLocalSocket* socket);
+  void executeBatch(QDataStream& in, QDataStream& out);
+  QString execute(quint8 opcode, QDataStream& in, QDataStream& out);
+
+  // Instantiates the given algorithm with the given values and seed and
+  // executes the given number of activations, then sets the system. Returns
+  // an error message or an empty string on success.
+  QString rebuild(const Checkpoint& checkpoint);
+
+  // Writes the result of a bulk run and counts its activations towards the
+  // current checkpoint.
+  void runResult(const Simulator::RunResult& result, QDataStream& out);
+
+  Simulator& sim;
+  AlgorithmList* algList;
+  QThread thread;
+  QLocalServer* server;
+  QString error;
+
+  // The system this server instantiated last and how to rebuild it.
+  std::shared_ptr<System> system;
+  Checkpoint current;
+  std::vector<Checkpoint> checkpoints;
+};
+
+#endif  // AMOEBOTSIM_SCRIPT_COMMANDSERVER_H_
@@ -0,0 +1,426 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "script/distributedsweep.h"
+
+#include <algorithm>
+
+#include <QCborArray>
+#include <QCborValue>
+#include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QtEndian>
+
+namespace {
+
+// Splits an address of the form host:port. Returns false if the address is
+// not a TCP address and thus names a local socket.
+bool parseTcpAddress(const QString& address, QString& host, quint16& port) {
+  const int colon = address.lastIndexOf(':');
+  if (colon <= 0) {
+    return false;
+  }
+  bool ok = false;
+  port = address.mid(colon + 1).toUShort(&ok);
+  host = address.left(colon);
+  return ok && port != 0;
+}
+
+// The largest message accepted. Results hold the metrics of a run, which are
+// far smaller; anything larger comes from a broken or hostile peer.
+constexpr quint32 maxMessageSize = 64 << 20;
+
+// Drops the connection without sending buffered messages.
+void abortConnection(QIODevice* socket) {
+  if (auto localSocket = qobject_cast<QLocalSocket*>(socket)) {
+    localSocket->abort();
+  } else if (auto tcpSocket = qobject_cast<QTcpSocket*>(socket)) {
+    tcpSocket->abort();
+  }
+}
+
+// Functions for framing messages. readMessage returns false if the socket does
+// not hold a complete message yet, or aborts the connection and returns false
+// if the message is larger than maxMessageSize.
+void writeMessage(QIODevice* socket, const QCborMap& message) {
+  const QByteArray payload = message.toCborValue().toCbor();
+  uchar header[4];
+  qToBigEndian<quint32>(payload.size(), header);
+  socket->write(reinterpret_cast<const char*>(header), sizeof(header));
+  socket->write(payload);
+}
+
+bool readMessage(QIODevice* socket, QCborMap& message) {
+  uchar header[4];
+  if (socket->peek(reinterpret_cast<char*>(header), sizeof(header))
+      < static_cast<qint64>(sizeof(header))) {
+    return false;
+  }
+  const quint32 size = qFromBigEndian<quint32>(header);
+  if (size > maxMessageSize) {
+    abortConnection(socket);
+    return false;
+  } else if (socket->bytesAvailable()
+             < static_cast<qint64>(sizeof(header) + size)) {
+    return false;
+  }
+  socket->skip(sizeof(header));
+  message = QCborValue::fromCbor(socket->read(size)).toMap();
+  return true;
+}
+
+// Sends any buffered messages and closes the connection.
+void closeConnection(QIODevice* socket) {
+  if (auto localSocket = qobject_cast<QLocalSocket*>(socket)) {
+    localSocket->flush();
+    localSocket->disconnectFromServer();
+  } else if (auto tcpSocket = qobject_cast<QTcpSocket*>(socket)) {
+    tcpSocket->flush();
+    tcpSocket->disconnectFromHost();
+  }
+}
+
+}  // namespace
+
+SweepCoordinator::SweepCoordinator(const ParameterSweep& sweep,
+                                   int maxAttempts)
+    : sweep(sweep),
+      maxAttempts(std::max(1, maxAttempts)),
+      numDone(0),
+      numRestarts(0),
+      maxRestarts(0) {
+  for (const ParameterSweep::Run& run : sweep.runs()) {
+    ParameterSweep::Result result;
+    result.run = run;
+    result.key = sweep.key(run);
+    result.valid = false;
+    result.cached = false;
+    result.steps = 0;
+    result.terminated = false;
+    pending.push_back(results.size());
+    results.push_back(result);
+  }
+  attempts.assign(results.size(), 0);
+  done.assign(results.size(), false);
+
+  connect(&localServer, &QLocalServer::newConnection, this, [this]() {
+    while (QLocalSocket* socket = localServer.nextPendingConnection()) {
+      connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+        removeWorker(socket);
+      });
+      addWorker(socket);
+    }
+  });
+  connect(&tcpServer, &QTcpServer::newConnection, this, [this]() {
+    while (QTcpSocket* socket = tcpServer.nextPendingConnection()) {
+      connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        removeWorker(socket);
+      });
+      addWorker(socket);
+    }
+  });
+}
+
+SweepCoordinator::~SweepCoordinator() {
+  for (auto& worker : workers) {
+    disconnect(worker.first, nullptr, this, nullptr);
+  }
+  for (QProcess* process : localWorkers) {
+    disconnect(process, nullptr, this, nullptr);
+    if (!process->waitForFinished(3000)) {
+      process->kill();
+      process->waitForFinished(1000);
+    }
+  }
+}
+
+bool SweepCoordinator::listen(const QString& address) {
+  this->address = address;
+  QString host;
+  quint16 port;
+  if (parseTcpAddress(address, host, port)) {
+    const QHostAddress hostAddress = (host == "*") ? QHostAddress::Any
+                                                   : QHostAddress(host);
+    if (!tcpServer.listen(hostAddress, port)) {
+      error = tcpServer.errorString();
+      return false;
+    }
+  } else {
+    // A stale socket file of a crashed coordinator would block the name.
+    QLocalServer::removeServer(address);
+    if (!localServer.listen(address)) {
+      error = localServer.errorString();
+      return false;
+    }
+  }
+  return true;
+}
+
+QString SweepCoordinator::errorString() const {
+  return error;
+}
+
+std::vector<ParameterSweep::Result> SweepCoordinator::execute(
+    int numLocalWorkers) {
+  maxRestarts = maxAttempts * numLocalWorkers;
+  for (int i = 0; i < numLocalWorkers && !isComplete(); ++i) {
+    startLocalWorker();
+  }
+
+  if (!isComplete()) {
+    QEventLoop loop;
+    connect(this, &SweepCoordinator::finished, &loop, &QEventLoop::quit);
+    loop.exec();
+  }
+  return results;
+}
+
+void SweepCoordinator::addWorker(QIODevice* socket) {
+  workers[socket] = -1;
+  connect(socket, &QIODevice::readyRead, this, [this, socket]() {
+    receive(socket);
+  });
+  if (isComplete()) {
+    writeMessage(socket, QCborMap{{"type", "done"}});
+    closeConnection(socket);
+  } else {
+    dispatch();
+  }
+}
+
+void SweepCoordinator::receive(QIODevice* socket) {
+  QCborMap message;
+  while (workers.count(socket) == 1 && readMessage(socket, message)) {
+    if (message.value("type").toString() != "result") {
+      continue;  // Workers only announce themselves otherwise.
+    }
+
+    const int index = static_cast<int>(message.value("index").toInteger(-1));
+    if (workers[socket] != index) {
+      continue;
+    }
+    workers[socket] = -1;
+
+    ParameterSweep::Result result = results[index];
+    result.valid = message.value("valid").toBool();
+    result.cached = message.value("cached").toBool();
+    result.steps = static_cast<quint64>(message.value("steps").toInteger());
+    result.terminated = message.value("terminated").toBool();
+    result.metrics = message.value("metrics").toMap().toJsonObject();
+    complete(index, result);
+    dispatch();
+  }
+}
+
+void SweepCoordinator::removeWorker(QIODevice* socket) {
+  auto it = workers.find(socket);
+  if (it == workers.end()) {
+    return;
+  }
+  const int index = it->second;
+  workers.erase(it);
+  socket->deleteLater();
+
+  if (index >= 0 && !done[index]) {
+    if (++attempts[index] < maxAttempts) {
+      pending.push_front(index);
+    } else {
+      giveUp(index);
+    }
+  }
+  dispatch();
+}
+
+void SweepCoordinator::dispatch() {
+  if (isComplete()) {
+    return;
+  }
+
+  for (auto& worker : workers) {
+    if (worker.second != -1 || pending.empty()) {
+      continue;
+    }
+    const int index = pending.front();
+    pending.pop_front();
+    worker.second = index;
+
+    const ParameterSweep::Run& run = results[index].run;
+    QCborMap message;
+    message["type"] = "run";
+    message["index"] = index;
+    message["signature"] = sweep.getAlgorithm()->getSignature();
+    message["values"] = QCborArray::fromStringList(run.values);
+    message["seed"] = static_cast<qint64>(run.seed);
+    message["stepLimit"] = static_cast<qint64>(sweep.getStepLimit());
+    message["cacheDir"] = QDir(sweep.getCacheDir()).absolutePath();
+    writeMessage(worker.first, message);
+  }
+
+  // Give up if all local workers are gone for good and nobody else helps.
+  if (maxRestarts > 0 && localWorkers.empty() && workers.empty()) {
+    for (unsigned int i = 0; i < done.size(); ++i) {
+      if (!done[i]) {
+        giveUp(i);
+      }
+    }
+  }
+}
+
+void SweepCoordinator::startLocalWorker() {
+  QString host, workerAddress = address;
+  quint16 port;
+  if (parseTcpAddress(address, host, port)
+      && (host == "*" || QHostAddress(host) == QHostAddress::AnyIPv4)) {
+    workerAddress = QString("127.0.0.1:%1").arg(port);
+  }
+
+  QProcess* process = new QProcess(this);
+  process->setProcessChannelMode(QProcess::ForwardedChannels);
+  connect(process, QOverload<int, QProcess::ExitStatus>::of(
+              &QProcess::finished), this, [this, process]() {
+    localWorkerFinished(process);
+  });
+  connect(process, &QProcess::errorOccurred, this,
+          [this, process](QProcess::ProcessError processError) {
+    if (processError == QProcess::FailedToStart) {
+      localWorkerFinished(process);
+    }
+  });
+  localWorkers.push_back(process);
+  process->start(QCoreApplication::applicationFilePath(),
+                 {"--sweep-worker", workerAddress});
+}
+
+void SweepCoordinator::localWorkerFinished(QProcess* process) {
+  auto it = std::find(localWorkers.begin(), localWorkers.end(), process);
+  if (it == localWorkers.end()) {
+    return;
+  }
+  localWorkers.erase(it);
+  process->deleteLater();
+
+  if (!isComplete()) {
+    if (numRestarts < maxRestarts) {
+      ++numRestarts;
+      startLocalWorker();
+    } else {
+      dispatch();
+    }
+  }
+}
+
+void SweepCoordinator::complete(int index,
+                                const ParameterSweep::Result& result) {
+  if (done[index]) {
+    return;
+  }
+  results[index] = result;
+  done[index] = true;
+  ++numDone;
+  pending.erase(std::remove(pending.begin(), pending.end(), index),
+                pending.end());
+
+  if (isComplete()) {
+    std::vector<QIODevice*> sockets;
+    for (auto& worker : workers) {
+      sockets.push_back(worker.first);
+    }
+    for (QIODevice* socket : sockets) {
+      writeMessage(socket, QCborMap{{"type", "done"}});
+      closeConnection(socket);
+    }
+    emit finished();
+  }
+}
+
+void SweepCoordinator::giveUp(int index) {
+  ParameterSweep::Result result = results[index];
+  result.valid = false;
+  complete(index, result);
+}
+
+bool SweepCoordinator::isComplete() const {
+  return numDone == static_cast<int>(results.size());
+}
+
+SweepWorker::SweepWorker(AlgorithmList& algList)
+    : algList(algList),
+      socket(nullptr) {}
+
+bool SweepWorker::connectTo(const QString& address) {
+  QString host;
+  quint16 port;
+  if (parseTcpAddress(address, host, port)) {
+    QTcpSocket* tcpSocket = new QTcpSocket(this);
+    tcpSocket->connectToHost(host, port);
+    if (!tcpSocket->waitForConnected()) {
+      return false;
+    }
+    connect(tcpSocket, &QTcpSocket::disconnected,
+            this, &SweepWorker::finished);
+    socket = tcpSocket;
+  } else {
+    QLocalSocket* localSocket = new QLocalSocket(this);
+    localSocket->connectToServer(address);
+    if (!localSocket->waitForConnected()) {
+      return false;
+    }
+    connect(localSocket, &QLocalSocket::disconnected,
+            this, &SweepWorker::finished);
+    socket = localSocket;
+  }
+
+  connect(socket, &QIODevice::readyRead, this, &SweepWorker::receive);
+  writeMessage(socket, QCborMap{{"type", "ready"}});
+  return true;
+}
+
+void SweepWorker::receive() {
+  QCborMap message;
+  while (readMessage(socket, message)) {
+    if (message.value("type").toString() == "done") {
+      emit finished();
+      return;
+    } else if (message.value("type").toString() != "run") {
+      continue;
+    }
+
+    ParameterSweep::Run run;
+    for (const QCborValue& value : message.value("values").toArray()) {
+      run.values.append(value.toString());
+    }
+    run.seed = static_cast<quint32>(message.value("seed").toInteger());
+
+    ParameterSweep::Result result;
+    result.valid = false;
+    result.cached = false;
+    result.steps = 0;
+    result.terminated = false;
+    Algorithm* alg =
+        algList.getAlgBySignature(message.value("signature").toString());
+    if (alg != nullptr
+        && run.values.size() == alg->getParameterNames().size()) {
+      const QString cacheDir = message.value("cacheDir").toString();
+      QDir().mkpath(cacheDir);
+      const ParameterSweep sweep(alg, {}, {},
+          static_cast<quint64>(message.value("stepLimit").toInteger()),
+          cacheDir);
+      result = sweep.execute(run);
+    }
+
+    QCborMap reply;
+    reply["type"] = "result";
+    reply["index"] = message.value("index");
+    reply["valid"] = result.valid;
+    reply["cached"] = result.cached;
+    reply["steps"] = static_cast<qint64>(result.steps);
+    reply["terminated"] = result.terminated;
+    reply["metrics"] = QCborMap::fromJsonObject(result.metrics);
+    writeMessage(socket, reply);
+  }
+}
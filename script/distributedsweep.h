@@ -0,0 +1,135 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Distributes the runs of a ParameterSweep over worker processes, which may be
+// local or on other machines sharing the sweep's cache directory. A
+// SweepCoordinator listens on a local socket or a TCP port and hands out one
+// run at a time to every SweepWorker that connects; workers execute runs with
+// ParameterSweep::execute, so cached runs are not repeated, and send back the
+// results. If a worker disconnects in the middle of a run, e.g., because it
+// crashed, the run is retried on another worker a limited number of times.
+//
+// Messages are CBOR maps prefixed by their length as a big-endian 32-bit
+// integer. A worker sends {type: "ready"} after connecting and {type:
+// "result", index, valid, cached, steps, terminated, metrics} after each run.
+// The coordinator answers with {type: "run", index, signature, values, seed,
+// stepLimit, cacheDir} or, once all runs are finished, {type: "done"}.
+//
+// Worker processes are started with "AmoebotSim --sweep-worker <address>",
+// which runs without a window (see main/main.cpp). An address of the form
+// host:port denotes a TCP socket; any other address is the name of a local
+// socket (a Unix domain socket or a Windows named pipe).
+
+#ifndef AMOEBOTSIM_SCRIPT_DISTRIBUTEDSWEEP_H_
+#define AMOEBOTSIM_SCRIPT_DISTRIBUTEDSWEEP_H_
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <QCborMap>
+#include <QIODevice>
+#include <QLocalServer>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QTcpServer>
+
+#include "script/parametersweep.h"
+#include "ui/algorithm.h"
+
+class SweepCoordinator : public QObject {
+  Q_OBJECT
+
+ public:
+  // Constructs a coordinator for the runs of the given sweep. A run is given
+  // up (and its result is invalid) after maxAttempts workers disconnected
+  // while executing it.
+  SweepCoordinator(const ParameterSweep& sweep, int maxAttempts = 3);
+
+  // Stops all local workers that are still running.
+  ~SweepCoordinator();
+
+  // Listens for workers on the given address. Returns false and logs the
+  // reason with errorString if the address cannot be used.
+  bool listen(const QString& address);
+  QString errorString() const;
+
+  // Starts the given number of local worker processes and waits until all runs
+  // are finished, handing them out to local workers and any remote workers
+  // that connect. Local workers that exit early are restarted, but at most
+  // maxAttempts times per local worker in total. Without local workers, this
+  // waits for remote ones. Returns the results in the order of the sweep's
+  // runs().
+  std::vector<ParameterSweep::Result> execute(int numLocalWorkers);
+
+ signals:
+  // Emitted once every run has a result.
+  void finished();
+
+ private:
+  // Functions for handling workers. addWorker registers a new connection,
+  // receive handles its messages, and removeWorker retries the run it was
+  // executing, if any. dispatch hands out pending runs to idle workers.
+  void addWorker(QIODevice* socket);
+  void receive(QIODevice* socket);
+  void removeWorker(QIODevice* socket);
+  void dispatch();
+
+  // Functions for handling local worker processes. startLocalWorker starts a
+  // new one, and localWorkerFinished restarts it if runs are left.
+  void startLocalWorker();
+  void localWorkerFinished(QProcess* process);
+
+  // Records the result of the run with the given index and emits finished if
+  // it was the last one. giveUp records the run as failed.
+  void complete(int index, const ParameterSweep::Result& result);
+  void giveUp(int index);
+  bool isComplete() const;
+
+  const ParameterSweep& sweep;
+  const int maxAttempts;
+  QString address;
+  QString error;
+  QLocalServer localServer;
+  QTcpServer tcpServer;
+
+  std::vector<ParameterSweep::Result> results;
+  std::vector<int> attempts;
+  std::vector<bool> done;
+  int numDone;
+  std::deque<int> pending;
+
+  // The run each connected worker is executing, or -1 if it is idle.
+  std::map<QIODevice*, int> workers;
+
+  std::vector<QProcess*> localWorkers;
+  int numRestarts;
+  int maxRestarts;
+};
+
+class SweepWorker : public QObject {
+  Q_OBJECT
+
+ public:
+  // Constructs a worker executing runs of the algorithms in the given list.
+  explicit SweepWorker(AlgorithmList& algList);
+
+  // Connects to the coordinator at the given address and asks for runs.
+  // Returns false if the connection fails.
+  bool connectTo(const QString& address);
+
+ signals:
+  // Emitted when the coordinator has no runs left or the connection is lost.
+  void finished();
+
+ private:
+  // Executes the runs the coordinator sends and replies with their results.
+  void receive();
+
+  AlgorithmList& algList;
+  QIODevice* socket;
+};
+
+#endif  // AMOEBOTSIM_SCRIPT_DISTRIBUTEDSWEEP_H_
@@ -0,0 +1,246 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "script/parametersweep.h"
+
+#include <memory>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFuture>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "core/system.h"
+#include "helper/randomnumbergenerator.h"
+
+namespace {
+
+// How many activations a run executes between checks of its cancel flag, and
+// how often the thread waiting for a sweep checks whether it was stopped.
+constexpr quint64 cancelInterval = 4096;
+constexpr int stopPollMs = 50;
+
+}  // namespace
+
+ParameterSweep::ParameterSweep(Algorithm* alg,
+                               const std::map<QString, QStringList>& grid,
+                               const std::vector<quint32>& seeds,
+                               quint64 stepLimit, const QString& cacheDir)
+    : alg(alg),
+      stepLimit(stepLimit),
+      cacheDir(cacheDir) {
+  Q_ASSERT(alg != nullptr);
+  const QStringList names = alg->getParameterNames();
+  const QStringList defaults = alg->getParameterDefaults();
+
+  std::vector<QStringList> axes;
+  for (int i = 0; i < names.size(); ++i) {
+    auto it = grid.find(names[i]);
+    axes.push_back(it != grid.end() ? it->second : QStringList(defaults[i]));
+    if (axes.back().isEmpty()) {
+      return;  // An empty axis makes the product empty.
+    }
+  }
+
+  // Enumerate the Cartesian product like an odometer, with the last parameter
+  // as the fastest digit.
+  std::vector<int> digits(axes.size(), 0);
+  while (true) {
+    Run run;
+    for (unsigned int i = 0; i < axes.size(); ++i) {
+      run.values.append(axes[i][digits[i]]);
+    }
+    for (quint32 seed : seeds) {
+      run.seed = seed;
+      _runs.push_back(run);
+    }
+
+    int i = static_cast<int>(axes.size()) - 1;
+    while (i >= 0 && ++digits[i] == axes[i].size()) {
+      digits[i--] = 0;
+    }
+    if (i < 0) {
+      break;
+    }
+  }
+}
+
+Algorithm* ParameterSweep::getAlgorithm() const {
+  return alg;
+}
+
+quint64 ParameterSweep::getStepLimit() const {
+  return stepLimit;
+}
+
+QString ParameterSweep::getCacheDir() const {
+  return cacheDir;
+}
+
+const std::vector<ParameterSweep::Run>& ParameterSweep::runs() const {
+  return _runs;
+}
+
+std::vector<ParameterSweep::Result> ParameterSweep::execute(
+    int numThreads, const std::function<bool()>& stopped) const {
+  QDir().mkpath(cacheDir);
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(numThreads > 0 ? numThreads
+                                        : QThread::idealThreadCount());
+  std::atomic<bool> cancel(false);
+  std::vector<QFuture<Result>> futures;
+  for (const Run& run : _runs) {
+    futures.push_back(QtConcurrent::run(&pool, [this, run, &cancel]() {
+      return execute(run, &cancel);
+    }));
+  }
+
+  waitForDone(pool, cancel, stopped);
+  std::vector<Result> results;
+  if (cancel) {
+    return results;
+  }
+  for (QFuture<Result>& future : futures) {
+    results.push_back(future.result());
+  }
+  return results;
+}
+
+ParameterSweep::Result ParameterSweep::execute(
+    const Run& run, const std::atomic<bool>* cancel) const {
+  Result result;
+  result.run = run;
+  result.key = key(run);
+  result.valid = false;
+  result.cached = false;
+  result.steps = 0;
+  result.terminated = false;
+  if ((cancel != nullptr && *cancel) || load(result.key, result)) {
+    return result;
+  }
+
+  std::shared_ptr<System> system =
+      simulate(alg, run.values, run.seed, stepLimit, result.steps, cancel);
+  if (system == nullptr || (cancel != nullptr && *cancel)) {
+    return result;
+  }
+
+  result.valid = true;
+  result.terminated = system->hasTerminated();
+  result.metrics =
+      QJsonDocument::fromJson(system->metricsAsJSON().toUtf8()).object();
+
+  store(result);
+  return result;
+}
+
+std::shared_ptr<System> ParameterSweep::simulate(
+    Algorithm* alg, const QStringList& values, quint32 seed,
+    quint64 stepLimit, quint64& steps, const std::atomic<bool>* cancel) {
+  // Systems use the generator of the thread they are constructed and
+  // activated on, so seeding it here makes the whole run reproducible.
+  RandomNumberGenerator::seed(seed);
+  std::shared_ptr<System> system = alg->createSystem(values);
+  steps = 0;
+  if (system != nullptr) {
+    while (!system->hasTerminated() && steps < stepLimit) {
+      if (cancel != nullptr && steps % cancelInterval == 0 && *cancel) {
+        break;
+      }
+      system->activate();
+      ++steps;
+    }
+  }
+  return system;
+}
+
+void ParameterSweep::waitForDone(QThreadPool& pool, std::atomic<bool>& cancel,
+                                 const std::function<bool()>& stopped) {
+  while (!pool.waitForDone(stopPollMs)) {
+    if (!cancel && stopped && stopped()) {
+      cancel = true;
+    }
+  }
+}
+
+QString ParameterSweep::key(const Run& run) const {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(alg->getSignature().toUtf8());
+  const QStringList names = alg->getParameterNames();
+  for (int i = 0; i < names.size(); ++i) {
+    hash.addData(QString("\n%1=%2").arg(names[i], run.values[i]).toUtf8());
+  }
+  hash.addData(QString("\nseed=%1\nstepLimit=%2\nbuild=%3")
+                   .arg(run.seed).arg(stepLimit).arg(buildId()).toUtf8());
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+QString ParameterSweep::buildId() {
+  static const QString id = []() {
+    if (QCoreApplication::instance() == nullptr) {
+      return QString("unknown");
+    }
+    QFile executable(QCoreApplication::applicationFilePath());
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!executable.open(QIODevice::ReadOnly) || !hash.addData(&executable)) {
+      return QString("unknown");
+    }
+    return QString::fromLatin1(hash.result().toHex());
+  }();
+  return id;
+}
+
+bool ParameterSweep::load(const QString& key, Result& result) const {
+  QFile file(cachePath(key));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  const QJsonObject entry = QJsonDocument::fromJson(file.readAll()).object();
+  if (entry.value("key").toString() != key) {
+    return false;  // A partial or foreign file; run again.
+  }
+
+  result.valid = true;
+  result.cached = true;
+  result.steps = static_cast<quint64>(entry.value("steps").toDouble());
+  result.terminated = entry.value("terminated").toBool();
+  result.metrics = entry.value("metrics").toObject();
+  return true;
+}
+
+void ParameterSweep::store(const Result& result) const {
+  QJsonObject parameters;
+  const QStringList names = alg->getParameterNames();
+  for (int i = 0; i < names.size(); ++i) {
+    parameters.insert(names[i], result.run.values[i]);
+  }
+
+  QJsonObject entry;
+  entry.insert("key", result.key);
+  entry.insert("algorithm", alg->getSignature());
+  entry.insert("parameters", parameters);
+  entry.insert("seed", static_cast<double>(result.run.seed));
+  entry.insert("stepLimit", static_cast<double>(stepLimit));
+  entry.insert("build", buildId());
+  entry.insert("steps", static_cast<double>(result.steps));
+  entry.insert("terminated", result.terminated);
+  entry.insert("metrics", result.metrics);
+
+  QSaveFile file(cachePath(result.key));
+  if (file.open(QIODevice::WriteOnly)) {
+    file.write(QJsonDocument(entry).toJson(QJsonDocument::Compact));
+    file.commit();
+  }
+}
+
+QString ParameterSweep::cachePath(const QString& key) const {
+  return QDir(cacheDir).filePath(key + ".json");
+}
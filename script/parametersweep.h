@@ -0,0 +1,128 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Runs an algorithm for every combination of the given parameter values and
+// seeds, in parallel and without a window. Each run is seeded, so it is
+// reproducible, and its metrics are cached on disk under a key derived from
+// the algorithm, its parameter values, the seed, the step limit, and the build
+// of the simulator. Running a sweep again only runs what is not cached yet.
+
+#ifndef AMOEBOTSIM_SCRIPT_PARAMETERSWEEP_H_
+#define AMOEBOTSIM_SCRIPT_PARAMETERSWEEP_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QtGlobal>
+
+#include "core/system.h"
+#include "ui/algorithm.h"
+
+class ParameterSweep {
+ public:
+  // A single run: one value per parameter of the algorithm, in the order of
+  // Algorithm::getParameterNames(), and a seed.
+  struct Run {
+    QStringList values;
+    quint32 seed;
+  };
+
+  // The outcome of a run. valid is false if the algorithm could not be
+  // instantiated with the run's values. cached is true if the outcome was read
+  // from the cache instead of being simulated. steps is the number of
+  // activations executed, and metrics holds the system's metrics in the format
+  // of System::metricsAsJSON().
+  struct Result {
+    Run run;
+    QString key;
+    bool valid;
+    bool cached;
+    quint64 steps;
+    bool terminated;
+    QJsonObject metrics;
+  };
+
+  // Constructs a sweep of the given algorithm over the Cartesian product of the
+  // given values of some of its parameters (by name) and the given seeds.
+  // Parameters not in the grid keep their default values. Every run executes
+  // activations until its system terminates or stepLimit activations have
+  // been executed. Results are cached as JSON files in the given directory.
+  ParameterSweep(Algorithm* alg, const std::map<QString, QStringList>& grid,
+                 const std::vector<quint32>& seeds, quint64 stepLimit,
+                 const QString& cacheDir);
+
+  // Functions for accessing the configuration of this sweep.
+  Algorithm* getAlgorithm() const;
+  quint64 getStepLimit() const;
+  QString getCacheDir() const;
+
+  // Returns the runs of this sweep. Later parameters vary faster than earlier
+  // ones, and the seed varies fastest.
+  const std::vector<Run>& runs() const;
+
+  // Executes all runs that are not cached on the given number of threads (the
+  // ideal thread count if not positive) and returns the results of all runs in
+  // the order of runs(). If given, stopped is polled on the calling thread
+  // while the runs execute; once it returns true, the runs are cancelled and
+  // no results are returned.
+  std::vector<Result> execute(
+      int numThreads = 0,
+      const std::function<bool()>& stopped = std::function<bool()>()) const;
+
+  // Returns the cached result of the given run or executes and caches it.
+  // Can be called from any thread. If the given flag is set before the run
+  // finishes, the run is abandoned and its incomplete result is not cached.
+  Result execute(const Run& run,
+                 const std::atomic<bool>* cancel = nullptr) const;
+
+  // Seeds the calling thread's generator with the given seed, instantiates the
+  // given algorithm with the given values, and executes activations until the
+  // system terminates or stepLimit activations have been executed, storing
+  // their number in steps. Returns nullptr if the values are invalid. Other
+  // commands that run seeded trials share this so they reproduce sweep runs.
+  // The given flag, if any, is checked every few thousand activations, and
+  // setting it ends the run early.
+  static std::shared_ptr<System> simulate(
+      Algorithm* alg, const QStringList& values, quint32 seed,
+      quint64 stepLimit, quint64& steps,
+      const std::atomic<bool>* cancel = nullptr);
+
+  // Waits until the given pool has no more work, polling stopped on the
+  // calling thread meanwhile and setting cancel once it returns true. The
+  // pool's tasks are expected to check cancel, e.g., through simulate. Flags
+  // like Simulator::isInterrupted can only be queried on the thread that
+  // started the work, which is why they are not checked by the tasks
+  // themselves.
+  static void waitForDone(QThreadPool& pool, std::atomic<bool>& cancel,
+                          const std::function<bool()>& stopped);
+
+  // Returns the cache key of the given run, a hex-encoded SHA-1 hash.
+  QString key(const Run& run) const;
+
+  // Returns an identifier of this build of the simulator, the hex-encoded SHA-1
+  // hash of its executable. Cached results of other builds are not used.
+  static QString buildId();
+
+ protected:
+  // Functions for reading and writing the cache. load returns false if the
+  // given run is not cached. store writes the file atomically, so concurrent
+  // sweeps sharing a cache never read partial results.
+  bool load(const QString& key, Result& result) const;
+  void store(const Result& result) const;
+  QString cachePath(const QString& key) const;
+
+  Algorithm* const alg;
+  const quint64 stepLimit;
+  const QString cacheDir;
+  std::vector<Run> _runs;
+};
+
+#endif  // AMOEBOTSIM_SCRIPT_PARAMETERSWEEP_H_
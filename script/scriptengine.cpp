@@ -4,32 +4,94 @@
 
 #include "script/scriptengine.h"
 
+#include <memory>
+
 #include <QFile>
 #include <QString>
 #include <QTextStream>
 
+#include "alg/shapeformation.h"
 #include "script/scriptinterface.h"
 
 ScriptEngine::ScriptEngine(Simulator& sim, VisItem* vis, AlgorithmList* algList)
-  : scriptInterface(new ScriptInterface(*this, sim, vis)),
-    _algList(algList) {
+  : sim(sim),
+    vis(vis),
+    engine(nullptr),
+    scriptInterface(nullptr),
+    _algList(algList),
+    runningScripts(false) {
+  // The initial system is set here rather than on the script thread so that
+  // the window has a system from the start.
+  sim.setSystem(std::make_shared<ShapeFormationSystem>(200, 0.2, "h"));
+
+  // The engine is created on the script thread, but before this returns so
+  // that the destructor can always interrupt it.
+  moveToThread(&thread);
+  thread.start();
+  QMetaObject::invokeMethod(this, &ScriptEngine::initialize,
+                            Qt::BlockingQueuedConnection);
+}
+
+ScriptEngine::~ScriptEngine() {
+  // Interrupt the running script, any bulk run it is in, and any call it is
+  // waiting for on this (the GUI) thread so that the script thread can stop.
+  // The engine is deleted on the script thread once its event loop exits.
+  sim.shutDown();
+  sim.stop();
+  engine->setInterrupted(true);
+  engine->deleteLater();
+  thread.quit();
+  thread.wait();
+}
+
+void ScriptEngine::initialize() {
   // Create a global object for the JavaScript engine and make its methods
-  // globally accessible. The engine owns the script interface.
-  auto globalObject = engine.newQObject(scriptInterface);
-  engine.globalObject().setProperty("globalObject", globalObject);
-  engine.evaluate("Object.keys(globalObject).forEach(function(key){ this[key] = globalObject[key] })");
+  // globally accessible. The engine owns the script interface, and this owns
+  // the engine, so both live on the script thread.
+  engine = new QJSEngine(this);
+  scriptInterface = new ScriptInterface(*this, sim, vis, _algList);
+  auto globalObject = engine->newQObject(scriptInterface);
+  engine->globalObject().setProperty("globalObject", globalObject);
+  engine->evaluate("Object.keys(globalObject).forEach(function(key){ this[key] = globalObject[key] })");
 
   // For each algorithm, register it with the script engine and associate its
   // signature (e.g., 'shapeformation' for the Basic Shape Formation algorithm)
   // with its ::instantiate() function defined in ui/algorithm.*
+  if (_algList == nullptr) {
+    return;
+  }
   for (auto alg : _algList->getAlgs()) {
-    auto algObject = engine.newQObject(alg);
-    engine.globalObject().setProperty(alg->getSignature(), algObject);
-    engine.evaluate("this[\"" + alg->getSignature() + "\"] = " + alg->getSignature() + "[\"instantiate\"]");
+    auto algObject = engine->newQObject(alg);
+    engine->globalObject().setProperty(alg->getSignature(), algObject);
+    engine->evaluate("this[\"" + alg->getSignature() + "\"] = " + alg->getSignature() + "[\"instantiate\"]");
   }
 }
 
 void ScriptEngine::runScript(const QString scriptFilePath) {
+  if (QThread::currentThread() != &thread) {
+    QMetaObject::invokeMethod(this, [this, scriptFilePath]() {
+      // Commands such as distributedSweep process events while they wait, so
+      // this can be called while a script runs; the script then runs after
+      // it instead of inside it.
+      pendingScripts.append(scriptFilePath);
+      if (runningScripts) {
+        return;
+      }
+      runningScripts = true;
+      while (!pendingScripts.isEmpty()) {
+        const QString next = pendingScripts.takeFirst();
+        // A new script is not affected by stops of the scripts before it.
+        sim.clearInterrupt();
+        runScript(next);
+        emit scriptFinished(next);
+      }
+      runningScripts = false;
+    }, Qt::QueuedConnection);
+    return;
+  } else if (engine.isNull() || engine->isInterrupted()) {
+    return;  // The application is quitting.
+  }
+
   QFile scriptFile(scriptFilePath);
 
   if (!scriptFile.open(QFile::ReadOnly)) {
@@ -42,5 +104,5 @@ void ScriptEngine::runScript(const QString scriptFilePath) {
 
   scriptFile.close();
 
-  engine.evaluate(script);
+  engine->evaluate(script);
 }
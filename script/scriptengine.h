@@ -2,11 +2,19 @@
  * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
  * notice can be found at the top of main/main.cpp. */
 
+// Runs scripts on a dedicated thread with its own JavaScript engine, so that
+// long-running scripts do not block the window. The engine and the script
+// interface are created on that thread when it starts. Script commands that
+// touch the window are carried out on the GUI thread (see scriptinterface.h).
+
 #ifndef AMOEBOTSIM_SCRIPT_SCRIPTENGINE_H_
 #define AMOEBOTSIM_SCRIPT_SCRIPTENGINE_H_
 
 #include <QJSEngine>
 #include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QThread>
 
 #include "core/simulator.h"
 #include "ui/algorithm.h"
@@ -19,19 +27,45 @@ class ScriptEngine : public QObject {
   Q_OBJECT
 
  public:
+  // Starts the script thread. The ScriptEngine itself lives on that thread.
   ScriptEngine(Simulator& sim, VisItem* vis = nullptr,
                AlgorithmList* algList = nullptr);
 
+  // Interrupts the running script, if any, and stops the script thread.
+  ~ScriptEngine();
+
  signals:
   void log(const QString msg, bool error = false);
 
+  // Emitted on the script thread when a script started by a call from another
+  // thread has finished.
+  void scriptFinished(const QString scriptFilePath);
+
  public slots:
+  // Loads a JavaScript script from the given file and evaluates it. Called
+  // from another thread, this returns immediately and the script runs on the
+  // script thread after any scripts started before it; scriptFinished is
+  // emitted once it is done. Called from a running script, the script is
+  // evaluated right away.
   void runScript(const QString scriptFilePath);
 
+ private slots:
+  // Creates the JavaScript engine and the script interface and registers the
+  // script commands and algorithms. Runs on the script thread when it starts,
+  // before the constructor returns.
+  void initialize();
+
  private:
-  QJSEngine engine;
+  Simulator& sim;
+  VisItem* vis;
+  QThread thread;
+  QPointer<QJSEngine> engine;
   ScriptInterface* scriptInterface;
   AlgorithmList* _algList;
+
+  // Scripts started from other threads that wait for the running one.
+  QStringList pendingScripts;
+  bool runningScripts;
 };
 
 #endif  // AMOEBOTSIM_SCRIPT_SCRIPTENGINE_H_
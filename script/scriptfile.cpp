@@ -0,0 +1,88 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "script/scriptfile.h"
+
+#include <algorithm>
+
+#include <QtConcurrent>
+
+ScriptFile::ScriptFile(const QString filePath, int bufferSize, bool background)
+    : file(filePath),
+      bufferSize(std::max(1, bufferSize)),
+      background(background),
+      failed(0) {
+  pool.setMaxThreadCount(1);
+}
+
+ScriptFile::~ScriptFile() {
+  close();
+}
+
+bool ScriptFile::open(bool truncate) {
+  failed.store(0);
+  buffer.reserve(bufferSize);
+  return file.open(truncate ? QIODevice::WriteOnly | QIODevice::Truncate
+                            : QIODevice::WriteOnly | QIODevice::Append);
+}
+
+QString ScriptFile::errorString() const {
+  return file.errorString();
+}
+
+void ScriptFile::write(const QString text) {
+  writeBinary(text.toUtf8());
+}
+
+void ScriptFile::writeBinary(const QByteArray data) {
+  if (!file.isOpen()) {
+    return;
+  }
+  buffer.append(data);
+  if (buffer.size() >= bufferSize) {
+    writeBuffer();
+  }
+}
+
+bool ScriptFile::flush() {
+  if (file.isOpen()) {
+    writeBuffer();
+    pending.waitForFinished();
+    if (!file.flush()) {
+      failed.store(1);
+    }
+  }
+  return failed.load() == 0;
+}
+
+bool ScriptFile::close() {
+  const bool ok = flush();
+  file.close();
+  return ok;
+}
+
+void ScriptFile::writeBuffer() {
+  if (buffer.isEmpty()) {
+    return;
+  }
+
+  pending.waitForFinished();
+  if (background) {
+    // The buffer's data is shared with the write, so the script starts a fresh
+    // buffer instead of detaching a copy of the old one.
+    const QByteArray data = buffer;
+    buffer = QByteArray();
+    buffer.reserve(bufferSize);
+    pending = QtConcurrent::run(&pool, [this, data]() {
+      if (file.write(data) != data.size()) {
+        failed.store(1);
+      }
+    });
+  } else {
+    if (file.write(buffer) != buffer.size()) {
+      failed.store(1);
+    }
+    buffer.resize(0);  // Keeps the reserved capacity.
+  }
+}
@@ -0,0 +1,63 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Defines a file that scripts keep open and write to repeatedly, returned by
+// ScriptInterface::openFile. Writes are collected in a buffer that is only
+// written to disk once it is full, so logging a line per round does not cost
+// a system call per line. With background writing, full buffers are written
+// on another thread while the script fills the next one.
+
+#ifndef AMOEBOTSIM_SCRIPT_SCRIPTFILE_H_
+#define AMOEBOTSIM_SCRIPT_SCRIPTFILE_H_
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFile>
+#include <QFuture>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+class ScriptFile : public QObject {
+  Q_OBJECT
+
+ public:
+  // Constructs a closed file at the given path that writes to disk once
+  // bufferSize bytes are buffered, on another thread if background is true.
+  ScriptFile(const QString filePath, int bufferSize, bool background);
+
+  // Writes any buffered data and closes the file.
+  ~ScriptFile();
+
+  // Opens the file for appending, or for writing from scratch if truncate is
+  // true. Returns false and sets errorString if it cannot be opened.
+  bool open(bool truncate);
+  QString errorString() const;
+
+ public slots:
+  // Script commands. write appends the given text in UTF-8, and writeBinary
+  // appends the contents of the given ArrayBuffer. flush writes all buffered
+  // data to disk and waits until it is written. close flushes and closes the
+  // file; later writes are ignored. flush and close return false if any write
+  // since the file was opened failed.
+  void write(const QString text);
+  void writeBinary(const QByteArray data);
+  bool flush();
+  bool close();
+
+ private:
+  // Hands the buffer off to be written, waiting for the previous background
+  // write to finish first so that data is written in order.
+  void writeBuffer();
+
+  QFile file;
+  QByteArray buffer;
+  const int bufferSize;
+  const bool background;
+  QThreadPool pool;
+  QFuture<void> pending;
+  QAtomicInt failed;
+};
+
+#endif  // AMOEBOTSIM_SCRIPT_SCRIPTFILE_H_
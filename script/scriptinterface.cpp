@@ -4,20 +4,47 @@
 
 #include "script/scriptinterface.h"
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include <QCoreApplication>
 #include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFuture>
+#include <QImage>
+#include <QJSEngine>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QPointF>
+#include <QSize>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
-#include "alg/shapeformation.h"
+#include "core/ensemblestatistics.h"
+#include "core/localparticle.h"
+#include "core/metricsfile.h"
 #include "core/node.h"
+#include "script/distributedsweep.h"
+#include "script/parametersweep.h"
+#include "script/scriptfile.h"
+#include "ui/renderbenchmark.h"
 
 ScriptInterface::ScriptInterface(ScriptEngine &engine, Simulator& sim,
-                                 VisItem *vis)
+                                 VisItem *vis, AlgorithmList* algList)
   : engine(engine),
     sim(sim),
-    vis(vis) {
-  sim.setSystem(std::make_shared<ShapeFormationSystem>(200, 0.2, "h"));
-}
+    vis(vis),
+    algList(algList),
+    filmFormat(FrameRecorder::Format::Png),
+    filmOverflow(FrameRecorder::Overflow::Block),
+    filmCapacity(16),
+    reportingProgress(false) {}
 
 void ScriptInterface::log(const QString msg, bool error) {
   emit engine.log(msg, error);
@@ -41,6 +68,26 @@ void ScriptInterface::writeToFile(const QString filePath, const QString text) {
   file.close();
 }
 
+QObject* ScriptInterface::openFile(const QString filePath, const QString mode,
+                                   const int bufferSize,
+                                   const bool background) {
+  if ((mode != "append" && mode != "truncate") || bufferSize < 1) {
+    log("Invalid file; mode must be \"append\" or \"truncate\", and "
+        "bufferSize must be positive", true);
+    return nullptr;
+  }
+
+  // Without a parent, the script engine owns the file and deletes it, which
+  // closes it, once the script no longer references it.
+  ScriptFile* file = new ScriptFile(filePath, bufferSize, background);
+  if (!file->open(mode == "truncate")) {
+    log("Could not open file: " + file->errorString(), true);
+    delete file;
+    return nullptr;
+  }
+  return file;
+}
+
 void ScriptInterface::step() {
   sim.step();
 }
@@ -55,7 +102,75 @@ void ScriptInterface::setStepDuration(const int ms) {
 }
 
 void ScriptInterface::runUntilTermination() {
+  if (inProgressCallback()) {
+    return;
+  }
   sim.runUntilTermination();
+  throwIfStopped();
+}
+
+QVariantMap ScriptInterface::stepN(const int n, const QJSValue onProgress) {
+  if (n < 0) {
+    log("Number of steps must be non-negative", true);
+    return QVariantMap();
+  }
+  return bulkRun([this, n]() { return sim.stepN(n); }, onProgress);
+}
+
+QVariantMap ScriptInterface::runRounds(const int k, const QJSValue onProgress) {
+  if (k < 0) {
+    log("Number of rounds must be non-negative", true);
+    return QVariantMap();
+  }
+  return bulkRun([this, k]() { return sim.runRounds(k); }, onProgress);
+}
+
+QVariantMap ScriptInterface::runUntil(const QString condition,
+                                      const int budget,
+                                      const QJSValue onProgress) {
+  if ((condition != "terminated" && condition != "round"
+       && condition != "move") || budget < 0) {
+    log("Invalid run; condition must be \"terminated\", \"round\", or "
+        "\"move\", and budget must be non-negative", true);
+    return QVariantMap();
+  }
+
+  Simulator::RunCondition runCondition = Simulator::RunCondition::Terminated;
+  if (condition == "round") {
+    runCondition = Simulator::RunCondition::Round;
+  } else if (condition == "move") {
+    runCondition = Simulator::RunCondition::Move;
+  }
+  return bulkRun([this, runCondition, budget]() {
+    return sim.runUntil(runCondition, budget);
+  }, onProgress);
+}
+
+void ScriptInterface::setHistoryPolicy(const QString policy,
+                                       const int capacity,
+                                       const double ratio) {
+  if (policy == "full") {
+    sim.setHistoryPolicy(HistoryPolicy::Full);
+  } else if (policy == "ring" && capacity >= 1) {
+    sim.setHistoryPolicy(HistoryPolicy::Ring, capacity);
+  } else if (policy == "geometric" && ratio > 1) {
+    sim.setHistoryPolicy(HistoryPolicy::Geometric, 0, ratio);
+  } else if (policy == "buckets" && capacity >= 2) {
+    sim.setHistoryPolicy(HistoryPolicy::Buckets, capacity);
+  } else {
+    log("Invalid history policy; ring requires capacity >= 1, buckets "
+        "requires capacity >= 2, and geometric requires ratio > 1", true);
+  }
+}
+
+void ScriptInterface::setTelemetry(const QString key, const int snapshotMs) {
+  if (inProgressCallback()) {
+    return;
+  } else if (snapshotMs < 0) {
+    log("Snapshot interval must be non-negative", true);
+  } else if (!sim.setTelemetry(key, snapshotMs)) {
+    log("Could not create telemetry \"" + key + "\"", true);
+  }
 }
 
 int ScriptInterface::getNumParticles() {
@@ -66,26 +181,173 @@ int ScriptInterface::getNumObjects() {
   return sim.numObjects();
 }
 
-void ScriptInterface::exportMetrics() {
-  sim.exportMetrics();
-  log("Metrics exported to application directory.");
+void ScriptInterface::exportMetrics(const QString format) {
+  if (sim.exportMetrics(format)) {
+    log("Metrics exported to application directory.");
+  } else {
+    log("Could not export metrics as \"" + format + "\"", true);
+  }
+}
+
+QVariantMap ScriptInterface::readMetrics(const QString filePath) {
+  MetricsFile file(filePath);
+  if (!file.open()) {
+    log("Could not read metrics file", true);
+    return QVariantMap();
+  }
+
+  // Group the columns by kind, each mapping a metric name to its values.
+  static const std::map<MetricsFile::Kind, QString> groups = {
+    {MetricsFile::Kind::Count, "counts"},
+    {MetricsFile::Kind::Measure, "measures"},
+    {MetricsFile::Kind::Rounds, "rounds"},
+    {MetricsFile::Kind::Min, "min"},
+    {MetricsFile::Kind::Max, "max"},
+    {MetricsFile::Kind::Mean, "mean"}
+  };
+  std::map<QString, QVariantMap> columns;
+  for (int i = 0; i < file.numColumns(); ++i) {
+    QVariantList values;
+    if (file.isIntegral(i)) {
+      for (auto val : file.countHistory(i)) {
+        values.append(QVariant::fromValue(val));
+      }
+    } else {
+      for (auto val : file.measureHistory(i)) {
+        values.append(val);
+      }
+    }
+    columns[groups.at(file.kind(i))].insert(file.name(i), values);
+  }
+
+  QVariantMap metrics;
+  metrics.insert("counts", columns["counts"]);
+  metrics.insert("measures", columns["measures"]);
+  for (const auto& group : columns) {
+    metrics.insert(group.first, group.second);
+  }
+  return metrics;
+}
+
+// Packs the samples of the given history into a buffer of 64-bit floats,
+// alternating between round and value.
+template<class T>
+static QByteArray historyBuffer(const History<T>& history) {
+  QByteArray buffer(2 * history.size() * sizeof(double), Qt::Uninitialized);
+  double* values = reinterpret_cast<double*>(buffer.data());
+  for (unsigned int i = 0; i < history.size(); ++i) {
+    values[2 * i] = history.roundAt(i);
+    values[2 * i + 1] = history.at(i);
+  }
+  return buffer;
+}
+
+QByteArray ScriptInterface::getParticleColumn(const QString column) {
+  using Getter = qint32 (*)(const Particle&);
+  static const std::map<QString, Getter> getters = {
+    {"headX", [](const Particle& p) { return p.head.x; }},
+    {"headY", [](const Particle& p) { return p.head.y; }},
+    {"tailX", [](const Particle& p) {
+       return p.isExpanded() ? p.tail().x : p.head.x;
+     }},
+    {"tailY", [](const Particle& p) {
+       return p.isExpanded() ? p.tail().y : p.head.y;
+     }},
+    {"globalTailDir", [](const Particle& p) { return p.globalTailDir; }},
+    {"orientation", [](const Particle& p) {
+       auto localParticle = dynamic_cast<const LocalParticle*>(&p);
+       return (localParticle != nullptr) ? localParticle->orientation : -1;
+     }},
+    {"state", [](const Particle& p) { return p.stateIndex(); }}
+  };
+  auto it = getters.find(column);
+  if (it == getters.end()) {
+    log("Unknown column \"" + column + "\"; the columns are: headX, headY, "
+        "tailX, tailY, globalTailDir, orientation, state", true);
+    return QByteArray();
+  }
+
+  std::shared_ptr<System> system = sim.getSystem();
+  QMutexLocker locker(&system->mutex);
+  QByteArray buffer(system->size() * sizeof(qint32), Qt::Uninitialized);
+  qint32* values = reinterpret_cast<qint32*>(buffer.data());
+  for (unsigned int i = 0; i < system->size(); ++i) {
+    values[i] = it->second(system->at(i));
+  }
+  return buffer;
+}
+
+QByteArray ScriptInterface::getMetricHistory(const QString name) {
+  std::shared_ptr<System> system = sim.getSystem();
+  QMutexLocker locker(&system->mutex);
+  for (const Count* c : system->getCounts()) {
+    if (c->_name == name) {
+      return historyBuffer(c->_history);
+    }
+  }
+  for (const Measure* m : system->getMeasures()) {
+    if (m->_name == name) {
+      return historyBuffer(m->_history);
+    }
+  }
+  log("Unknown metric \"" + name + "\"", true);
+  return QByteArray();
+}
+
+QVariantList ScriptInterface::getStateHistogram() {
+  std::shared_ptr<System> system = sim.getSystem();
+  QMutexLocker locker(&system->mutex);
+  QVariantList histogram;
+  for (quint64 count : system->stateHistogram()) {
+    histogram.append(count);
+  }
+  return histogram;
+}
+
+int ScriptInterface::countInState(const int state) {
+  std::shared_ptr<System> system = sim.getSystem();
+  QMutexLocker locker(&system->mutex);
+  return system->countInState(state);
+}
+
+QVariantList ScriptInterface::getDegreeHistogram() {
+  std::shared_ptr<System> system = sim.getSystem();
+  QMutexLocker locker(&system->mutex);
+  QVariantList histogram;
+  for (quint64 count : system->degreeHistogram()) {
+    histogram.append(count);
+  }
+  return histogram;
+}
+
+int ScriptInterface::countInRegion(const int x, const int y,
+                                   const int radius) {
+  std::shared_ptr<System> system = sim.getSystem();
+  QMutexLocker locker(&system->mutex);
+  return system->countInRegion(Node(x, y), radius);
 }
 
 void ScriptInterface::setWindowSize(int width, int height) {
   if(vis != nullptr) {
-    vis->setWindowSize(width, height);
+    onGuiThread([&]() { vis->setWindowSize(width, height); });
   }
 }
 
 void ScriptInterface::focusOn(int x, int y) {
   if (vis != nullptr) {
-    vis->focusOn(Node(x, y));
+    onGuiThread([&]() { vis->focusOn(Node(x, y)); });
   }
 }
 
 void ScriptInterface::setZoom(float zoom) {
   if(vis != nullptr) {
-    vis->setZoom(zoom);
+    onGuiThread([&]() { vis->setZoom(zoom); });
+  }
+}
+
+void ScriptInterface::zoomToFit() {
+  if (vis != nullptr) {
+    onGuiThread([&]() { vis->zoomToFit(); });
   }
 }
 
@@ -95,32 +357,494 @@ void ScriptInterface::saveScreenshot(QString filePath) {
                QString::number(QDateTime::currentSecsSinceEpoch()) + ".png";
   }
 
-  sim.saveScreenshotSetup(filePath);
+  if (vis != nullptr) {
+    onGuiThread([&]() { sim.saveScreenshotSetup(filePath); });
+  } else {
+    renderImage(filePath, 800, 600);
+  }
 }
 
-void ScriptInterface::filmSimulation(QString filePath, const int stepLimit) {
-  int fnameLen = 0;
-  int temp = stepLimit;
-  while (temp >= 10) {
-    ++fnameLen;
-    temp = temp % 10;
+void ScriptInterface::filmSimulation(QString filePath, const int stepLimit,
+                                     const int interval, const QString unit) {
+  const bool perRound = (unit == "rounds");
+  if (interval < 1 || (!perRound && unit != "steps")) {
+    log("Invalid film interval; it must be at least 1 and counted in \"steps\" "
+        "or \"rounds\"", true);
+    return;
+  }
+
+  FrameRecorder recorder(filePath, filmFormat, filmOverflow, filmCapacity,
+                         QString::number(std::max(0, stepLimit - 1)).length());
+  if (!recorder.isOpen()) {
+    log("Could not open \"" + filePath + ".raw\"", true);
+    return;
   }
 
-  int i = 0;
-  while(!sim.getSystem()->hasTerminated() && i < stepLimit) {
-    emit vis->beforeRendering();  // Updates GUI #rounds and #movements labels.
-    saveScreenshot(filePath + pad(i,fnameLen) + QString(".png"));
+  // Without a window, frames are rendered on the CPU with the camera fixed at
+  // the first frame.
+  static const QSize headlessSize(800, 600);
+  QPointF focus;
+  double zoom = 0;
+
+  std::shared_ptr<System> system = sim.getSystem();
+  quint64 lastRound = 0;
+  for (int i = 0; i < stepLimit && !system->hasTerminated()
+                  && !sim.isInterrupted(); ++i) {
+    bool capture = (i % interval == 0);
+    if (perRound) {
+      QMutexLocker locker(&system->mutex);
+      const quint64 round = system->getCount("# Rounds")._value;
+      capture = (i == 0 || round >= lastRound + interval);
+      if (capture) {
+        lastRound = round;
+      }
+    }
+
+    if (capture) {
+      if (filmOverflow == FrameRecorder::Overflow::Drop && recorder.isFull()) {
+        recorder.skipFrame();
+      } else if (vis != nullptr) {
+        QImage frame;
+        if (!onGuiThread([&]() {
+              // Updates GUI #rounds and #movements labels.
+              emit vis->beforeRendering();
+              frame = vis->grabFrame();
+            })) {
+          break;  // The application is quitting.
+        }
+        recorder.addFrame(frame);
+      } else {
+        renderer.capture(*system);
+        if (zoom <= 0) {
+          focus = renderer.bounds().center();
+          zoom = renderer.zoomToFit(headlessSize);
+        }
+        recorder.addFrame(renderer.render(focus, zoom, headlessSize));
+      }
+    }
+
     step();
-    ++i;
   }
+
+  if (!recorder.finish()) {
+    log("Could not write all frames to \"" + filePath + "\"", true);
+  }
+  if (recorder.numDropped() > 0) {
+    log(QString::number(recorder.numDropped()) +
+        " frames were dropped because encoding fell behind");
+  }
+  throwIfStopped();
 }
 
-QString ScriptInterface::pad(const int number, const int length) {
-  QString str = "" + QString::number(number);
+void ScriptInterface::setFilmPolicy(const QString format,
+                                    const QString overflow,
+                                    const int capacity) {
+  if ((format != "png" && format != "raw")
+      || (overflow != "block" && overflow != "drop") || capacity < 1) {
+    log("Invalid film policy; format must be \"png\" or \"raw\", overflow must "
+        "be \"block\" or \"drop\", and capacity must be at least 1", true);
+    return;
+  }
+
+  filmFormat = (format == "raw") ? FrameRecorder::Format::Raw
+                                 : FrameRecorder::Format::Png;
+  filmOverflow = (overflow == "drop") ? FrameRecorder::Overflow::Drop
+                                      : FrameRecorder::Overflow::Block;
+  filmCapacity = capacity;
+}
 
-  while(str.length() < length) {
-    str = QString("0") + str;
+void ScriptInterface::renderImage(QString filePath, int width, int height,
+                                  float zoom) {
+  if (filePath == "") {
+    filePath = QString("amoebotsim_") +
+               QString::number(QDateTime::currentSecsSinceEpoch()) + ".png";
+  }
+  if (width <= 0 || height <= 0) {
+    log("Image width and height must be positive", true);
+    return;
+  }
+
+  const QSize size(width, height);
+  renderer.capture(*sim.getSystem());
+  const double imageZoom = (zoom > 0) ? zoom : renderer.zoomToFit(size);
+  const QImage image = renderer.render(renderer.bounds().center(), imageZoom,
+                                       size);
+  if (image.isNull() || !image.save(filePath)) {
+    log("Could not render image to \"" + filePath + "\"", true);
+  }
+}
+
+void ScriptInterface::renderTiles(QString filePrefix, int width, int height,
+                                  int tileSize, float zoom) {
+  if (width <= 0 || height <= 0 || tileSize <= 0) {
+    log("Image width, height, and tile size must be positive", true);
+    return;
+  }
+
+  const QSize size(width, height);
+  renderer.capture(*sim.getSystem());
+  const double imageZoom = (zoom > 0) ? zoom : renderer.zoomToFit(size);
+  if (!renderer.renderTiles(renderer.bounds().center(), imageZoom, size,
+                            QSize(tileSize, tileSize), filePrefix)) {
+    log("Could not render tiles to \"" + filePrefix + "\"", true);
+  }
+}
+
+QVariantMap ScriptInterface::benchmarkRendering(const QString renderer,
+                                                const int numFrames,
+                                                const int stepsPerFrame,
+                                                const float zoom,
+                                                const int width,
+                                                const int height) {
+  if ((renderer != "opengl" && renderer != "software") || numFrames < 1
+      || stepsPerFrame < 0 || zoom <= 0 || width <= 0 || height <= 0) {
+    log("Invalid benchmark; renderer must be \"opengl\" or \"software\", "
+        "numFrames, zoom, width, and height must be positive, and "
+        "stepsPerFrame must be non-negative", true);
+    return QVariantMap();
+  }
+
+  RenderBenchmark benchmark(QSize(width, height), zoom, stepsPerFrame);
+  RenderBenchmark::Result result;
+  if (renderer == "opengl") {
+    // Offscreen surfaces can only be created on the GUI thread.
+    bool ran = false;
+    onGuiThread([&]() {
+      ran = benchmark.runOpenGL(*sim.getSystem(), numFrames, result);
+    });
+    if (!ran) {
+      log("Could not create an offscreen OpenGL context", true);
+      return QVariantMap();
+    }
+  } else {
+    benchmark.runSoftware(*sim.getSystem(), numFrames, result);
+  }
+
+  log(QString("%1 frames (%2): first %3 ms, mean %4 ms, max %5 ms, "
+              "%6 draw calls and %7 bytes uploaded per frame")
+          .arg(result.numFrames).arg(renderer).arg(result.firstFrameMs)
+          .arg(result.meanFrameMs).arg(result.maxFrameMs)
+          .arg(result.drawCallsPerFrame).arg(result.uploadedBytesPerFrame));
+
+  QVariantMap results;
+  results.insert("numFrames", result.numFrames);
+  results.insert("firstFrameMs", result.firstFrameMs);
+  results.insert("meanFrameMs", result.meanFrameMs);
+  results.insert("maxFrameMs", result.maxFrameMs);
+  results.insert("drawCallsPerFrame", result.drawCallsPerFrame);
+  results.insert("uploadedBytesPerFrame", result.uploadedBytesPerFrame);
+  return results;
+}
+
+QVariantList ScriptInterface::sweep(const QString signature,
+                                    const QVariantMap grid,
+                                    const QVariantList seeds,
+                                    const double stepLimit,
+                                    const QString cacheDir,
+                                    const int numThreads) {
+  std::unique_ptr<ParameterSweep> parameterSweep =
+      createSweep(signature, grid, seeds, stepLimit, cacheDir);
+  if (parameterSweep == nullptr) {
+    return QVariantList();
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  const std::vector<ParameterSweep::Result> results =
+      parameterSweep->execute(numThreads, [this]() {
+        return sim.isInterrupted();
+      });
+  if (sim.isInterrupted()) {
+    throwIfStopped();
+    return QVariantList();
+  }
+  return sweepResults(*parameterSweep, results, timer.elapsed());
+}
+
+QVariantList ScriptInterface::distributedSweep(const QString signature,
+                                               const QVariantMap grid,
+                                               const QVariantList seeds,
+                                               const double stepLimit,
+                                               const QString cacheDir,
+                                               const int numWorkers,
+                                               const QString address,
+                                               const int maxAttempts) {
+  std::unique_ptr<ParameterSweep> parameterSweep =
+      createSweep(signature, grid, seeds, stepLimit, cacheDir);
+  if (parameterSweep == nullptr) {
+    return QVariantList();
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  QDir().mkpath(cacheDir);
+  SweepCoordinator coordinator(*parameterSweep, maxAttempts);
+  const QString listenAddress = address.isEmpty()
+      ? QString("amoebotsim-sweep-%1").arg(QCoreApplication::applicationPid())
+      : address;
+  if (!coordinator.listen(listenAddress)) {
+    log("Could not listen on \"" + listenAddress + "\": " +
+        coordinator.errorString(), true);
+    return QVariantList();
+  }
+  const int numLocalWorkers = (numWorkers >= 0) ? numWorkers
+                                                : QThread::idealThreadCount();
+  return sweepResults(*parameterSweep, coordinator.execute(numLocalWorkers),
+                      timer.elapsed());
+}
+
+QVariantMap ScriptInterface::ensemble(const QString signature,
+                                      const QVariantMap parameters,
+                                      const int maxTrials,
+                                      const double stepLimit,
+                                      const double targetWidth,
+                                      const QVariantList quantiles,
+                                      const int numThreads,
+                                      const int roundStride,
+                                      const int firstSeed) {
+  Algorithm* alg = findAlgorithm(signature, parameters.keys());
+  if (alg == nullptr) {
+    return QVariantMap();
+  } else if (maxTrials < 1 || stepLimit < 1 || roundStride < 1) {
+    log("An ensemble needs at least one trial, a step limit of at least 1, "
+        "and a round stride of at least 1", true);
+    return QVariantMap();
+  }
+
+  const QStringList names = alg->getParameterNames();
+  QStringList values = alg->getParameterDefaults();
+  for (auto it = parameters.begin(); it != parameters.end(); ++it) {
+    values[names.indexOf(it.key())] = it.value().toString();
   }
 
-  return str;
+  // Trials run in batches of a few per thread, each adding to its own
+  // aggregate, so the stopping rule is checked regularly without locking.
+  QThreadPool pool;
+  pool.setMaxThreadCount(numThreads > 0 ? numThreads
+                                        : QThread::idealThreadCount());
+  const int batchSize = 4 * pool.maxThreadCount();
+  const quint64 limit = static_cast<quint64>(stepLimit);
+  std::atomic<bool> cancel(false);
+  auto runTrial = [alg, values, limit, roundStride, &cancel](quint32 seed) {
+    EnsembleStatistics trial(roundStride);
+    quint64 steps = 0;
+    std::shared_ptr<System> system =
+        ParameterSweep::simulate(alg, values, seed, limit, steps, &cancel);
+    if (system != nullptr) {
+      trial.addTrial(*system, system->hasTerminated(), steps);
+    }
+    return trial;
+  };
+
+  QElapsedTimer timer;
+  timer.start();
+  EnsembleStatistics ensembleStats(roundStride);
+  bool converged = false;
+  for (int first = 0; first < maxTrials && !converged && !sim.isInterrupted();
+       first += batchSize) {
+    std::vector<QFuture<EnsembleStatistics>> futures;
+    for (int i = first; i < std::min(first + batchSize, maxTrials); ++i) {
+      futures.push_back(QtConcurrent::run(
+          &pool, runTrial, static_cast<quint32>(firstSeed + i)));
+    }
+    ParameterSweep::waitForDone(pool, cancel, [this]() {
+      return sim.isInterrupted();
+    });
+    if (cancel) {
+      break;  // The cancelled trials are incomplete.
+    }
+    for (QFuture<EnsembleStatistics>& future : futures) {
+      ensembleStats.merge(future.result());
+    }
+    converged = targetWidth > 0 &&
+        2 * ensembleStats.terminationRounds().stats.confidenceHalfWidth()
+        <= targetWidth;
+  }
+  if (sim.isInterrupted()) {
+    throwIfStopped();
+    return QVariantMap();
+  }
+
+  log(QString("%1 trials (%2 terminated) in %3 ms%4")
+      .arg(ensembleStats.numTrials())
+      .arg(ensembleStats.numTerminated())
+      .arg(timer.elapsed())
+      .arg(converged ? ", stopped early" : ""));
+  return ensembleResult(ensembleStats, quantiles);
+}
+
+QVariantMap ScriptInterface::mergeEnsembles(const QVariantList states,
+                                            const QVariantList quantiles) {
+  if (states.isEmpty()) {
+    log("There are no ensembles to merge", true);
+    return QVariantMap();
+  }
+
+  EnsembleStatistics ensembleStats = EnsembleStatistics::fromJson(
+      QJsonObject::fromVariantMap(states[0].toMap()));
+  for (int i = 1; i < states.size(); ++i) {
+    const EnsembleStatistics other = EnsembleStatistics::fromJson(
+        QJsonObject::fromVariantMap(states[i].toMap()));
+    if (!ensembleStats.canMerge(other)) {
+      log("Only ensembles with the same round stride can be merged", true);
+      return QVariantMap();
+    }
+    ensembleStats.merge(other);
+  }
+  return ensembleResult(ensembleStats, quantiles);
+}
+
+Algorithm* ScriptInterface::findAlgorithm(const QString signature,
+                                          const QStringList parameterNames) {
+  Algorithm* alg = (algList != nullptr) ? algList->getAlgBySignature(signature)
+                                        : nullptr;
+  if (alg == nullptr) {
+    log("Unknown algorithm \"" + signature + "\"", true);
+    return nullptr;
+  }
+
+  const QStringList names = alg->getParameterNames();
+  for (const QString& name : parameterNames) {
+    if (!names.contains(name)) {
+      log("Unknown parameter \"" + name + "\"; the parameters of " +
+          signature + " are: " + names.join(", "), true);
+      return nullptr;
+    }
+  }
+  return alg;
+}
+
+QVariantMap ScriptInterface::ensembleResult(
+    const EnsembleStatistics& ensembleStats, const QVariantList quantiles) {
+  std::vector<double> summaryQuantiles;
+  for (const QVariant& q : quantiles) {
+    summaryQuantiles.push_back(q.toDouble());
+  }
+
+  QVariantMap result = ensembleStats.summary(summaryQuantiles).toVariantMap();
+  result.insert("state", ensembleStats.toJson().toVariantMap());
+  return result;
+}
+
+std::unique_ptr<ParameterSweep> ScriptInterface::createSweep(
+    const QString signature, const QVariantMap grid, const QVariantList seeds,
+    const double stepLimit, const QString cacheDir) {
+  Algorithm* alg = findAlgorithm(signature, grid.keys());
+  if (alg == nullptr) {
+    return nullptr;
+  } else if (seeds.isEmpty() || stepLimit < 1) {
+    log("A sweep needs at least one seed and a step limit of at least 1",
+        true);
+    return nullptr;
+  }
+
+  std::map<QString, QStringList> sweepGrid;
+  for (auto it = grid.begin(); it != grid.end(); ++it) {
+    const QVariantList values = (it.value().type() == QVariant::List)
+                                ? it.value().toList()
+                                : QVariantList({it.value()});
+    for (const QVariant& value : values) {
+      sweepGrid[it.key()].append(value.toString());
+    }
+  }
+  std::vector<quint32> sweepSeeds;
+  for (const QVariant& seed : seeds) {
+    sweepSeeds.push_back(seed.toUInt());
+  }
+
+  return std::unique_ptr<ParameterSweep>(new ParameterSweep(
+      alg, sweepGrid, sweepSeeds, static_cast<quint64>(stepLimit), cacheDir));
+}
+
+QVariantList ScriptInterface::sweepResults(
+    const ParameterSweep& parameterSweep,
+    const std::vector<ParameterSweep::Result>& results, const qint64 ms) {
+  const QStringList names = parameterSweep.getAlgorithm()->getParameterNames();
+  QVariantList list;
+  int numCached = 0;
+  for (const ParameterSweep::Result& result : results) {
+    QVariantMap parameters;
+    for (int i = 0; i < names.size(); ++i) {
+      parameters.insert(names[i], result.run.values[i]);
+    }
+
+    QVariantMap entry;
+    entry.insert("parameters", parameters);
+    entry.insert("seed", result.run.seed);
+    entry.insert("valid", result.valid);
+    entry.insert("cached", result.cached);
+    entry.insert("steps", result.steps);
+    entry.insert("terminated", result.terminated);
+    entry.insert("metrics", result.metrics.toVariantMap());
+    list.append(entry);
+    numCached += result.cached ? 1 : 0;
+  }
+  log(QString("%1 runs (%2 cached) in %3 ms").arg(results.size())
+                                             .arg(numCached)
+                                             .arg(ms));
+  return list;
+}
+
+QVariantMap ScriptInterface::bulkRun(
+    const std::function<Simulator::RunResult()>& run,
+    QJSValue onProgress) {
+  if (inProgressCallback()) {
+    return QVariantMap();
+  }
+
+  // Progress is emitted on the thread executing the run, which is this one
+  // for the runs started here. Runs of other threads, e.g., the command
+  // server's, are not reported to the script.
+  QMetaObject::Connection connection;
+  if (onProgress.isCallable()) {
+    connection = connect(&sim, &Simulator::progress, this,
+                         [this, &onProgress](quint64 steps, quint64 rounds,
+                                             double stepsPerSecond) {
+      if (QThread::currentThread() != thread()) {
+        return;
+      }
+      reportingProgress = true;
+      const QJSValue result = onProgress.call({
+        QJSValue(static_cast<double>(steps)),
+        QJSValue(static_cast<double>(rounds)),
+        QJSValue(stepsPerSecond)
+      });
+      reportingProgress = false;
+      if (result.isError()) {
+        log("Progress callback: " + result.toString(), true);
+      }
+    }, Qt::DirectConnection);
+  }
+  const QVariantMap result = runResult(run());
+  disconnect(connection);
+  throwIfStopped();
+  return result;
+}
+
+bool ScriptInterface::inProgressCallback() {
+  if (reportingProgress) {
+    log("Progress callbacks cannot start bulk runs or change the telemetry",
+        true);
+  }
+  return reportingProgress;
+}
+
+QVariantMap ScriptInterface::runResult(const Simulator::RunResult& result) {
+  QVariantMap results;
+  results.insert("steps", result.steps);
+  results.insert("rounds", result.rounds);
+  results.insert("ms", result.ms);
+  results.insert("terminated", result.terminated);
+  return results;
+}
+
+bool ScriptInterface::onGuiThread(const std::function<void()>& function) {
+  return sim.onGuiThread(function);
+}
+
+void ScriptInterface::throwIfStopped() {
+  QJSEngine* jsEngine = qjsEngine(this);
+  if (sim.isInterrupted() && jsEngine != nullptr) {
+    jsEngine->throwError("Stopped");
+  }
 }
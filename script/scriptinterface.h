@@ -7,27 +7,49 @@
 #ifndef AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
 #define AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
 
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <QByteArray>
+#include <QJSValue>
 #include <QObject>
 #include <QString>
+#include <QVariantList>
+#include <QVariantMap>
 
+#include "core/ensemblestatistics.h"
 #include "core/simulator.h"
+#include "script/parametersweep.h"
 #include "script/scriptengine.h"
+#include "ui/algorithm.h"
+#include "ui/framerecorder.h"
+#include "ui/softwarerenderer.h"
 #include "ui/visitem.h"
 
 class ScriptInterface : public QObject {
   Q_OBJECT
 
  public:
-  explicit ScriptInterface(ScriptEngine& engine, Simulator& sim, VisItem* vis);
+  explicit ScriptInterface(ScriptEngine& engine, Simulator& sim, VisItem* vis,
+                           AlgorithmList* algList = nullptr);
 
  public slots:
   // Script commands. log writes a message to the simulator engine, optionally
   // flagging an error. runScript loads a JavaScript script from the provided
   // filepath and executes it. writeToFile appends the specified text to a file
-  // at the given location.
+  // at the given location. openFile opens a file that stays open for repeated
+  // writes, which are buffered and written bufferSize bytes at a time, on
+  // another thread if background is true; mode is "append" or "truncate". It
+  // returns an object with write(text), writeBinary(arrayBuffer), flush(), and
+  // close() functions, or null if the file cannot be opened. See
+  // script/scriptfile.h.
   void log(const QString msg, bool error = false);
   void runScript(const QString scriptFilePath);
   void writeToFile(const QString filePath, const QString text);
+  QObject* openFile(const QString filePath, const QString mode = "append",
+                    const int bufferSize = 1 << 20,
+                    const bool background = false);
 
   // Simulator flow commands. step executes a single particle activation.
   // setStepDuration sets the simulator's delay between particle activations to
@@ -38,33 +60,240 @@ class ScriptInterface : public QObject {
   void setStepDuration(const int ms);
   void runUntilTermination();
 
+  // Bulk flow commands, which run many activations natively and are much
+  // faster than calling step in a loop. stepN executes n activations, and
+  // runRounds executes activations until k more rounds have completed.
+  // runUntil executes activations until the given condition holds:
+  // "terminated", "round" (the current round completes), or "move" (a particle
+  // moves); at most budget activations are executed unless budget is 0. All
+  // stop early if the algorithm terminates and return an object with the
+  // number of activations executed (steps), rounds completed (rounds), the
+  // time taken (ms), and whether the algorithm terminated (terminated). If the
+  // simulation is stopped, they and runUntilTermination end the script. If
+  // onProgress is a function, it is called about twice a second during the
+  // run with the activations executed and rounds completed so far and the
+  // activations per second; it may inspect the system but not start other
+  // bulk runs or change the telemetry. The commands still return only when
+  // the run is done, so scripts stay sequential.
+  QVariantMap stepN(const int n, const QJSValue onProgress = QJSValue());
+  QVariantMap runRounds(const int k, const QJSValue onProgress = QJSValue());
+  QVariantMap runUntil(const QString condition, const int budget = 0,
+                       const QJSValue onProgress = QJSValue());
+
   // Simulator metrics commands. getNumParticles and getNumObjects return the
   // number of particles and objects in the given instance, respectively.
-  // exportMetrics writes the metrics to JSON. See simulator.h for further
-  // discussion.
+  // exportMetrics writes the metrics to a file in the given format ("json",
+  // "binary", or "binary-delta"). See simulator.h for further discussion.
+  // readMetrics loads a binary metrics file and returns an object whose
+  // "counts" and "measures" properties map each metric name to its history;
+  // downsampled histories additionally appear under "rounds" (and "min",
+  // "max", "mean" for buckets). See metricsfile.h for the format.
+  // setHistoryPolicy bounds the memory used by metric histories of this and
+  // all later instances: policy is "full", "ring", "geometric", or "buckets",
+  // capacity bounds ring and bucket histories, and ratio sets the geometric
+  // sampling ratio. See metric.h for further discussion.
   int getNumParticles();
   int getNumObjects();
-  void exportMetrics();
+  void exportMetrics(const QString format = "json");
+  QVariantMap readMetrics(const QString filePath);
+  void setHistoryPolicy(const QString policy, const int capacity = 0,
+                        const double ratio = 2.0);
+
+  // Telemetry commands. setTelemetry publishes the progress and metrics of
+  // bulk runs, and a snapshot of the particles every snapshotMs milliseconds,
+  // in shared memory under the given key, where other processes can observe
+  // them, e.g., a window started with "AmoebotSim --attach <key>". An empty key
+  // stops publishing. See core/telemetry.h.
+  void setTelemetry(const QString key, const int snapshotMs = 5000);
+
+  // Snapshot commands, which return the current state as an ArrayBuffer to be
+  // read through a typed array, e.g., new Int32Array(getParticleColumn(
+  // "headX")). The buffer shares the memory it was filled in, so no
+  // per-particle objects or strings are created. getParticleColumn returns one
+  // 32-bit integer per particle, in the system's order: column is "headX",
+  // "headY", "tailX" and "tailY" (the head's if contracted), "globalTailDir"
+  // (-1 if contracted), "orientation" (-1 without a local compass), or "state"
+  // (see Particle::stateIndex). getMetricHistory returns the retained history
+  // of the count or measure with the given name as 64-bit floats, alternating
+  // between the round and the value of each sample (see metric.h).
+  QByteArray getParticleColumn(const QString column);
+  QByteArray getMetricHistory(const QString name);
+
+  // Aggregation commands, computed natively over the current configuration
+  // instead of iterating over particles in the script. getStateHistogram
+  // returns an array with the number of particles in each state (see
+  // Particle::stateIndex), and countInState the number in the given state.
+  // getDegreeHistogram returns an array whose d-th entry is the number of
+  // particles with d neighboring particles. countInRegion returns the number
+  // of particles whose heads are within radius lattice steps of the node (x,y).
+  // See system.h for further discussion.
+  QVariantList getStateHistogram();
+  int countInState(const int state);
+  QVariantList getDegreeHistogram();
+  int countInRegion(const int x, const int y, const int radius);
 
   // Visualization commands. focusOn centers the window at the given (x,y) node.
-  // setZoom sets the zoom level of the window. saveScreenshot saves the current
-  // window as a .png in the specified location; if no filepath is provided, a
-  // default path is created that ensures no previous screenshots are
-  // overwritten. filmSimulation saves a series of screenshots to the specified
-  // location, up to the specified number of steps.
+  // setZoom sets the zoom level of the window. zoomToFit centers the window on
+  // the system and zooms so that the whole system is visible. saveScreenshot
+  // saves the current window as a .png in the specified location; if no
+  // filepath is provided, a default path is created that ensures no previous
+  // screenshots are overwritten; if there is no window, the image is rendered
+  // on the CPU as by renderImage. filmSimulation records a series of frames
+  // to the specified location while running up to the specified number of
+  // steps, capturing a frame every interval steps or rounds (unit "steps" or
+  // "rounds"). Frames are encoded in the background as set by setFilmPolicy:
+  // format is "png" for a numbered image sequence or "raw" for one RGBA stream,
+  // and overflow decides whether the simulation waits ("block") or frames are
+  // dropped ("drop") once capacity frames await encoding. See
+  // ui/framerecorder.h for further discussion.
   void setWindowSize(int width = 800, int height = 600);
   void focusOn(int x, int y);
   void setZoom(float zoom);
+  void zoomToFit();
   void saveScreenshot(QString filePath = "");
-  void filmSimulation(QString filePath, const int stepLimit);
+  void filmSimulation(QString filePath, const int stepLimit,
+                      const int interval = 1, const QString unit = "steps");
+  void setFilmPolicy(const QString format = "png",
+                     const QString overflow = "block",
+                     const int capacity = 16);
+
+  // Offscreen rendering commands, which render the current system on the CPU
+  // independently of the window. renderImage saves a .png of the given size
+  // (with the same default path as saveScreenshot). The zoom is in pixels per
+  // unit of length; if it is not positive, the whole system is fit into the
+  // image. renderTiles renders images too large to hold in memory as a grid of
+  // .png tiles of at most tileSize by tileSize pixels, saved as
+  // <filePrefix>_<row>_<column>.png. See ui/softwarerenderer.h.
+  void renderImage(QString filePath = "", int width = 1920, int height = 1080,
+                   float zoom = 0);
+  void renderTiles(QString filePrefix, int width, int height,
+                   int tileSize = 4096, float zoom = 0);
+
+  // Benchmark commands. benchmarkRendering renders the current system offscreen
+  // for the given number of frames with the given renderer ("opengl" for the
+  // renderers of the window or "software" for the CPU renderer), taking the
+  // given number of steps between frames. It logs and returns an object with
+  // the first frame's time (firstFrameMs), the mean and maximum time of the
+  // other frames (meanFrameMs, maxFrameMs), and the draw calls and bytes of
+  // vertex data uploaded per frame (drawCallsPerFrame,
+  // uploadedBytesPerFrame). See ui/renderbenchmark.h.
+  QVariantMap benchmarkRendering(const QString renderer = "opengl",
+                                 const int numFrames = 100,
+                                 const int stepsPerFrame = 0,
+                                 const float zoom = 16, const int width = 1920,
+                                 const int height = 1080);
+
+  // Sweep commands. sweep runs the algorithm with the given signature for every
+  // combination of parameter values in grid and seed in seeds, without a
+  // window and on numThreads threads (all cores if not positive). grid maps
+  // parameter names (as shown in the sidebar) to arrays of values; other
+  // parameters keep their defaults. Each run stops when the algorithm
+  // terminates or after stepLimit activations. Results are cached in cacheDir
+  // and reused by later sweeps of the same build. It returns an array with an
+  // object per run holding its parameters, seed, steps, whether it terminated
+  // and was cached, and its metrics as in exportMetrics. See
+  // script/parametersweep.h.
+  QVariantList sweep(const QString signature, const QVariantMap grid,
+                     const QVariantList seeds, const double stepLimit,
+                     const QString cacheDir = "sweeps",
+                     const int numThreads = 0);
+
+  // distributedSweep runs the same sweep on worker processes instead of
+  // threads, retrying a run up to maxAttempts times if its worker crashes. It
+  // starts numWorkers local workers (one per core if negative) and listens for
+  // more on address, a local socket name (a fresh one if empty) or host:port
+  // for TCP. Workers on other machines sharing cacheDir at the same path join
+  // with "AmoebotSim --sweep-worker host:port". It returns the same array as
+  // sweep. See script/distributedsweep.h.
+  QVariantList distributedSweep(const QString signature,
+                                const QVariantMap grid,
+                                const QVariantList seeds,
+                                const double stepLimit,
+                                const QString cacheDir = "sweeps",
+                                const int numWorkers = -1,
+                                const QString address = "",
+                                const int maxAttempts = 3);
+
+  // Ensemble commands. ensemble runs up to maxTrials trials of the algorithm
+  // with the given signature and parameter values (others keep their
+  // defaults), seeded firstSeed, firstSeed + 1, ..., on numThreads threads
+  // (all cores if not positive). Each trial stops when the algorithm
+  // terminates or after stepLimit activations. Only streaming aggregates of
+  // the trials' metric histories are kept, every roundStride rounds. If
+  // targetWidth is positive, trials stop early once the 95% confidence
+  // interval of the mean termination round is at most that wide. It returns an
+  // object with the number of trials and of terminated trials, the mean,
+  // standard deviation, and given quantiles of the termination rounds and
+  // steps, the same per round for every metric, and the aggregates themselves
+  // (state). mergeEnsembles merges the states of ensembles with the same round
+  // stride, e.g., run by several processes with disjoint seeds, and returns
+  // the same kind of object for all of their trials. See
+  // core/ensemblestatistics.h.
+  QVariantMap ensemble(const QString signature, const QVariantMap parameters,
+                       const int maxTrials, const double stepLimit,
+                       const double targetWidth = 0,
+                       const QVariantList quantiles = {0.05, 0.5, 0.95},
+                       const int numThreads = 0, const int roundStride = 1,
+                       const int firstSeed = 0);
+  QVariantMap mergeEnsembles(const QVariantList states,
+                             const QVariantList quantiles = {0.05, 0.5, 0.95});
 
  private:
+  // Runs the given function on the GUI thread and waits for it to return.
+  // Scripts run on their own thread (see scriptengine.h), but the window may
+  // only be accessed from the GUI thread. Returns false without running the
+  // function if the application is quitting (see Simulator::shutDown).
+  bool onGuiThread(const std::function<void()>& function);
+
+  // Ends the script with an error if the simulation was stopped, so that
+  // scripts that loop over bulk runs do not ignore the stop button.
+  void throwIfStopped();
+
+  // Returns the algorithm with the given signature, or nullptr after logging
+  // why if there is none or it has no parameter with one of the given names.
+  Algorithm* findAlgorithm(const QString signature,
+                           const QStringList parameterNames);
+
+  // Converts the aggregates of an ensemble into the script object returned by
+  // the ensemble commands.
+  static QVariantMap ensembleResult(const EnsembleStatistics& ensembleStats,
+                                    const QVariantList quantiles);
+
+  // Functions shared by the sweep commands. createSweep returns nullptr and
+  // logs why if the arguments do not describe a valid sweep. sweepResults
+  // converts results into script objects and logs how long they took.
+  std::unique_ptr<ParameterSweep> createSweep(const QString signature,
+                                              const QVariantMap grid,
+                                              const QVariantList seeds,
+                                              const double stepLimit,
+                                              const QString cacheDir);
+  QVariantList sweepResults(const ParameterSweep& parameterSweep,
+                            const std::vector<ParameterSweep::Result>& results,
+                            const qint64 ms);
+
+  // Functions shared by the bulk flow commands. bulkRun executes the given
+  // run, calling onProgress (if it is a function) whenever the run reports
+  // its progress, and converts its result into a script object.
+  // inProgressCallback returns true and logs an error if called from such a
+  // callback, during which the run holds the simulator's bulk run mutex.
+  QVariantMap bulkRun(const std::function<Simulator::RunResult()>& run,
+                      QJSValue onProgress);
+  bool inProgressCallback();
+
+  // Converts the result of a bulk run into a script object.
+  static QVariantMap runResult(const Simulator::RunResult& result);
+
   ScriptEngine& engine;
   Simulator& sim;
   VisItem* vis;
+  AlgorithmList* algList;
+  SoftwareRenderer renderer;
+
+  FrameRecorder::Format filmFormat;
+  FrameRecorder::Overflow filmOverflow;
+  int filmCapacity;
 
-  // Pads the given number with leading zeroes to achieve the specified length.
-  QString pad(const int number, const int length);
+  bool reportingProgress;
 };
 
 #endif  // AMOEBOTSIM_SCRIPT_SCRIPTINTERFACE_H_
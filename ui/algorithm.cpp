@@ -56,6 +56,36 @@ void Algorithm::addParameter(QString parameter, QString defaultValue) {
   _parameters.push_back(std::make_pair(parameter, defaultValue));
 }
 
+// The system instantiated by the createSystem call running on this thread, if
+// any.
+static thread_local std::shared_ptr<System>* createdSystem = nullptr;
+
+void Algorithm::instantiateWith(const QStringList& values) {
+  QStringList params = getParameterDefaults();
+  for (int i = 0; i < params.size() && i < values.size(); ++i) {
+    if (values[i].compare("") != 0) {
+      params[i] = values[i];
+    }
+  }
+  instantiateFromStrings(params);
+}
+
+std::shared_ptr<System> Algorithm::createSystem(const QStringList& values) {
+  std::shared_ptr<System> system;
+  createdSystem = &system;
+  instantiateWith(values);
+  createdSystem = nullptr;
+  return system;
+}
+
+void Algorithm::provideSystem(std::shared_ptr<System> system) {
+  if (createdSystem != nullptr) {
+    *createdSystem = system;
+  } else {
+    emit setSystem(system);
+  }
+}
+
 DiscoDemoAlg::DiscoDemoAlg() : Algorithm("Demo: Disco", "discodemo") {
   addParameter("# Particles", "30");
   addParameter("Counter Max", "5");
@@ -67,10 +97,14 @@ void DiscoDemoAlg::instantiate(const int numParticles, const int counterMax) {
   } else if (counterMax <= 0) {
     emit log("counterMax must be > 0", true);
   } else {
-    emit setSystem(std::make_shared<DiscoDemoSystem>(numParticles));
+    provideSystem(std::make_shared<DiscoDemoSystem>(numParticles));
   }
 }
 
+void DiscoDemoAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toInt());
+}
+
 MetricsDemoAlg::MetricsDemoAlg() : Algorithm("Demo: Metrics", "metricsdemo") {
   addParameter("# Particles", "30");
   addParameter("Counter Max", "5");
@@ -82,16 +116,24 @@ void MetricsDemoAlg::instantiate(const int numParticles, const int counterMax) {
   } else if (counterMax <= 0) {
     emit log("counterMax must be > 0", true);
   } else {
-    emit setSystem(std::make_shared<MetricsDemoSystem>(numParticles));
+    provideSystem(std::make_shared<MetricsDemoSystem>(numParticles));
   }
 }
 
+void MetricsDemoAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toInt());
+}
+
 BallroomDemoAlg::BallroomDemoAlg() : Algorithm("Demo: Ballroom", "ballroomdemo") {
   addParameter("# Particles", "30");
 }
 
 void BallroomDemoAlg::instantiate(const int numParticles) {
-  emit setSystem(std::make_shared<BallroomDemoSystem>(numParticles));
+  provideSystem(std::make_shared<BallroomDemoSystem>(numParticles));
+}
+
+void BallroomDemoAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt());
 }
 
 TokenDemoAlg::TokenDemoAlg() : Algorithm("Demo: Token Passing", "tokendemo") {
@@ -105,10 +147,14 @@ void TokenDemoAlg::instantiate(const int numParticles, const int lifetime) {
   } else if (lifetime <= 0) {
     emit log("token lifetime must be > 0", true);
   } else {
-    emit setSystem(std::make_shared<TokenDemoSystem>(numParticles, lifetime));
+    provideSystem(std::make_shared<TokenDemoSystem>(numParticles, lifetime));
   }
 }
 
+void TokenDemoAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toInt());
+}
+
 CompressionAlg::CompressionAlg() : Algorithm("Compression", "compression") {
   addParameter("# Particles", "100");
   addParameter("Lambda", "4.0");
@@ -118,10 +164,14 @@ void CompressionAlg::instantiate(const int numParticles, const double lambda) {
   if (numParticles <= 0) {
     emit log("# particles must be > 0", true);
   } else {
-    emit setSystem(std::make_shared<CompressionSystem>(numParticles, lambda));
+    provideSystem(std::make_shared<CompressionSystem>(numParticles, lambda));
   }
 }
 
+void CompressionAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toDouble());
+}
+
 InfObjCoatingAlg::InfObjCoatingAlg() :
   Algorithm("Infinite Object Coating", "infobjcoating") {
   addParameter("# Particles", "100");
@@ -135,11 +185,15 @@ void InfObjCoatingAlg::instantiate(const int numParticles,
   } else if (holeProb < 0 || holeProb > 1) {
     emit log("holeProb in [0,1] required", true);
   } else {
-    emit setSystem(std::make_shared<InfObjCoatingSystem>(numParticles,
-                                                         holeProb));
+    provideSystem(std::make_shared<InfObjCoatingSystem>(numParticles,
+                                                        holeProb));
   }
 }
 
+void InfObjCoatingAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toDouble());
+}
+
 LeaderElectionAlg::LeaderElectionAlg() :
   Algorithm("Leader Election", "leaderelection") {
   addParameter("# Particles", "100");
@@ -153,11 +207,15 @@ void LeaderElectionAlg::instantiate(const int numParticles,
   } else if (holeProb < 0 || holeProb > 1) {
     emit log("holeProb in [0,1] required", true);
   } else {
-    emit setSystem(std::make_shared<LeaderElectionSystem>(numParticles,
-                                                          holeProb));
+    provideSystem(std::make_shared<LeaderElectionSystem>(numParticles,
+                                                         holeProb));
   }
 }
 
+void LeaderElectionAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toDouble());
+}
+
 ShapeFormationAlg::ShapeFormationAlg() :
   Algorithm("Basic Shape Formation", "shapeformation") {
   addParameter("# Particles", "200");
@@ -180,11 +238,15 @@ void ShapeFormationAlg::instantiate(const int numParticles,
     }
     emit log("only accepted modes are: " + accepted, true);
   } else {
-    emit setSystem(std::make_shared<ShapeFormationSystem>(numParticles,
-                                                          holeProb, mode));
+    provideSystem(std::make_shared<ShapeFormationSystem>(numParticles,
+                                                         holeProb, mode));
   }
 }
 
+void ShapeFormationAlg::instantiateFromStrings(const QStringList& values) {
+  instantiate(values[0].toInt(), values[1].toDouble(), values[2]);
+}
+
 TriangleRotationAlg::TriangleRotationAlg() :
     Algorithm("Rotate a triangle (3k+1)", "trianglerotate") {
     addParameter("side Length", "7");
@@ -197,10 +259,14 @@ void TriangleRotationAlg::instantiate(const int sideLength, const int setCenter)
     } else if (sideLength % 3 != 1) {
        emit  log("Sidelength must form a perfect triangle with a one particle center. So 3k+1 for some k.", true);
     } else {
-       emit setSystem(std::make_shared<TriangleRotateSystem>(sideLength, setCenter));
+       provideSystem(std::make_shared<TriangleRotateSystem>(sideLength, setCenter));
     }
 }
 
+void TriangleRotationAlg::instantiateFromStrings(const QStringList& values) {
+    instantiate(values[0].toInt(), values[1].toInt());
+}
+
 AlgorithmList::AlgorithmList() {
   // Demo algorithms.
   _algorithms.push_back(new DiscoDemoAlg());  
@@ -237,6 +303,16 @@ Algorithm* AlgorithmList::getAlg(QString algName) const {
   return algo;
 }
 
+Algorithm* AlgorithmList::getAlgBySignature(QString signature) const {
+  for (auto alg : _algorithms) {
+    if (alg->getSignature().compare(signature) == 0) {
+      return alg;
+    }
+  }
+
+  return nullptr;
+}
+
 QStringList AlgorithmList::getAlgNames() const {
   QStringList names;
   for (auto alg : _algorithms) {
@@ -36,10 +36,29 @@ class Algorithm : public QObject {
   // Adds a parameter to the algorithm of the given name and default value.
   void addParameter(QString parameter, QString defaultValue);
 
+  // Instantiates this algorithm from parameter values given as strings, in the
+  // order of getParameterNames(); missing or empty values take their defaults.
+  // instantiateWith sets the new system in the simulator like the instantiate
+  // slots. createSystem instead returns it, or nullptr if the values are
+  // invalid (the reason is logged); it can be called from any thread, e.g., to
+  // run many systems in parallel.
+  void instantiateWith(const QStringList& values);
+  std::shared_ptr<System> createSystem(const QStringList& values);
+
  signals:
   void log(const QString msg, bool error = false);
   void setSystem(std::shared_ptr<System> system);
 
+ protected:
+  // Converts the given values (one per parameter) and calls the instantiate
+  // slot. Must be overridden by every algorithm.
+  virtual void instantiateFromStrings(const QStringList& values) = 0;
+
+  // Hands a newly instantiated system to createSystem if it is being called on
+  // this thread, and emits setSystem otherwise. All instantiate slots pass
+  // their systems through this function.
+  void provideSystem(std::shared_ptr<System> system);
+
  private:
   QString _name;
   QString _signature;
@@ -57,6 +76,9 @@ class DiscoDemoAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 30, const int counterMax = 5);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Demo: Metrics.
@@ -68,6 +90,9 @@ class MetricsDemoAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 30, const int counterMax = 5);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Demo: Ballroom, a tutorial in coordination.
@@ -79,6 +104,9 @@ class BallroomDemoAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 30);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Demo: Token Passing.
@@ -90,6 +118,9 @@ class TokenDemoAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 48, const int lifetime = 100);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Compression.
@@ -101,6 +132,9 @@ class CompressionAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 100, const double lambda = 4.0);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Infinite Object Coating.
@@ -112,6 +146,9 @@ class InfObjCoatingAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 100, const double holeProb = 0.2);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Leader Election.
@@ -123,6 +160,9 @@ class LeaderElectionAlg : public Algorithm {
 
  public slots:
   void instantiate(const int numParticles = 100, const double holeProb = 0.2);
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Basic Shape Formation.
@@ -135,6 +175,9 @@ class ShapeFormationAlg : public Algorithm {
  public slots:
   void instantiate(const int numParticles = 200, const double holeProb = 0.2,
                    const QString mode = "h");
+
+ protected:
+  void instantiateFromStrings(const QStringList& values) override;
 };
 
 // Triangle Rotation for 3k+1
@@ -146,6 +189,9 @@ public:
 
 public slots:
     void instantiate(const int sideLength = 7, const int setCenter = 1);
+
+protected:
+    void instantiateFromStrings(const QStringList& values) override;
 };
 
 class AlgorithmList {
@@ -160,8 +206,10 @@ class AlgorithmList {
   // Returns a list of all the algorithms in this list.
   std::vector<Algorithm*> getAlgs();
 
-  // Returns the algorithm object of the given algorithm.
+  // Returns the algorithm object of the given algorithm, or nullptr if there is
+  // none. getAlgBySignature looks the algorithm up by its signature instead.
   Algorithm* getAlg(QString algName) const;
+  Algorithm* getAlgBySignature(QString signature) const;
 
   // Returns a list of all the algorithm's names in this list.
   QStringList getAlgNames() const;
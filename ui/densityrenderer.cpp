@@ -0,0 +1,175 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/densityrenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QRgb>
+
+#include "core/object.h"
+#include "ui/particlerenderer.h"
+
+DensityRenderer::DensityRenderer()
+    : _numObjects(0),
+      quadsDirty(true),
+      _drawCalls(0),
+      _uploadedBytes(0) {}
+
+void DensityRenderer::rebuild(const System& system) {
+  tiles.clear();
+  contributions.clear();
+  contributions.reserve(system.size());
+
+  for (const Particle& p : system) {
+    const qint64 key = tileKey(p.head);
+    const int color = colorOf(p);
+    contributions[&p] = std::make_pair(key, color);
+    add(key, color);
+  }
+
+  _numObjects = system.numObjects();
+  for (const Object* o : system.getObjects()) {
+    add(tileKey(o->_node), 0x000000);
+  }
+
+  quadsDirty = true;
+}
+
+void DensityRenderer::update(const std::vector<const Particle*>& changed) {
+  for (const Particle* p : changed) {
+    auto it = contributions.find(p);
+    Q_ASSERT(it != contributions.end());
+    const qint64 key = tileKey(p->head);
+    const int color = colorOf(*p);
+    if (it->second.first != key || it->second.second != color) {
+      remove(it->second.first, it->second.second);
+      add(key, color);
+      it->second = std::make_pair(key, color);
+      quadsDirty = true;
+    }
+  }
+}
+
+void DensityRenderer::clear() {
+  tiles.clear();
+  contributions.clear();
+  _numObjects = 0;
+  quadsDirty = true;
+}
+
+unsigned int DensityRenderer::numObjects() const {
+  return _numObjects;
+}
+
+void DensityRenderer::draw(QOpenGLFunctions_2_0* glfn) {
+  if (quadsDirty) {
+    generateQuads();
+  }
+
+  if (vertices.empty()) {
+    return;
+  }
+
+  glfn->glDisable(GL_TEXTURE_2D);
+  glfn->glEnableClientState(GL_VERTEX_ARRAY);
+  glfn->glEnableClientState(GL_COLOR_ARRAY);
+  glfn->glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+  glfn->glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors.data());
+  glfn->glDrawArrays(GL_QUADS, 0, vertices.size() / 2);
+  glfn->glDisableClientState(GL_COLOR_ARRAY);
+  glfn->glDisableClientState(GL_VERTEX_ARRAY);
+  glfn->glEnable(GL_TEXTURE_2D);
+
+  ++_drawCalls;
+  _uploadedBytes += vertices.size() * sizeof(GLfloat)
+                    + colors.size() * sizeof(GLubyte);
+}
+
+int DensityRenderer::drawCalls() const {
+  return _drawCalls;
+}
+
+qint64 DensityRenderer::uploadedBytes() const {
+  return _uploadedBytes;
+}
+
+void DensityRenderer::resetStats() {
+  _drawCalls = 0;
+  _uploadedBytes = 0;
+}
+
+int DensityRenderer::colorOf(const Particle& p) {
+  const int color = p.headMarkColor();
+  return (color != -1) ? color : 0x000000;
+}
+
+void DensityRenderer::add(qint64 key, int color) {
+  Tile& tile = tiles[key];
+  ++tile.count;
+  ++tile.colorCounts[color];
+}
+
+void DensityRenderer::remove(qint64 key, int color) {
+  auto it = tiles.find(key);
+  Q_ASSERT(it != tiles.end());
+  Tile& tile = it->second;
+  if (--tile.colorCounts[color] == 0) {
+    tile.colorCounts.erase(color);
+  }
+  if (--tile.count == 0) {
+    tiles.erase(it);
+  }
+}
+
+qint64 DensityRenderer::tileKey(const Node& node) {
+  const quint64 tileX = static_cast<quint32>(node.x >> tileShift);
+  return (tileX << 32) | static_cast<quint32>(node.y >> tileShift);
+}
+
+void DensityRenderer::generateQuads() {
+  static constexpr int tileSize = 1 << tileShift;
+  static constexpr double maxCount = tileSize * tileSize;
+
+  vertices.clear();
+  colors.clear();
+  vertices.reserve(8 * tiles.size());
+  colors.reserve(16 * tiles.size());
+
+  for (const auto& entry : tiles) {
+    // Recover the tile coordinates from the key (see tileKey).
+    const int tileX = static_cast<int>(entry.first >> 32);
+    const int tileY = static_cast<int>(static_cast<qint32>(entry.first));
+    const Tile& tile = entry.second;
+
+    // The tile covers the nodes (x, y) with x in [x0, x0 + tileSize) and y in
+    // [y0, y0 + tileSize); its quad extends half a unit beyond these so that
+    // adjacent tiles meet.
+    const double x0 = tileX * tileSize - 0.5, y0 = tileY * tileSize - 0.5;
+    const double xs[4] = {x0, x0 + tileSize, x0 + tileSize, x0};
+    const double ys[4] = {y0, y0, y0 + tileSize, y0 + tileSize};
+
+    const auto dominant = std::max_element(
+        tile.colorCounts.begin(), tile.colorCounts.end(),
+        [](const std::pair<const int, int>& a,
+           const std::pair<const int, int>& b) {
+          return a.second < b.second;
+        });
+    const int color = dominant->first;
+    const GLubyte alpha = static_cast<GLubyte>(
+        255 * std::min(1.0, tile.count / maxCount));
+
+    for (int i = 0; i < 4; ++i) {
+      vertices.push_back(xs[i] + 0.5 * ys[i]);
+      vertices.push_back(ys[i] * ParticleRenderer::triangleHeight);
+      colors.push_back(qRed(color));
+      colors.push_back(qGreen(color));
+      colors.push_back(qBlue(color));
+      colors.push_back(alpha);
+    }
+  }
+
+  quadsDirty = false;
+}
@@ -0,0 +1,88 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Draws a level-of-detail view of a system for when particles are too small to
+// be drawn individually. The lattice is divided into square tiles (in lattice
+// coordinates, so they are parallelograms on screen), and every tile holding
+// particle heads or objects is drawn as one quad in the tile's dominant color
+// with an opacity proportional to its density. The tiles' aggregates are
+// updated incrementally from the particles that changed.
+
+#ifndef AMOEBOTSIM_UI_DENSITYRENDERER_H_
+#define AMOEBOTSIM_UI_DENSITYRENDERER_H_
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QOpenGLFunctions_2_0>
+#include <QtGlobal>
+
+#include "core/particle.h"
+#include "core/system.h"
+
+class DensityRenderer {
+ public:
+  DensityRenderer();
+
+  // Functions for maintaining the tiles. rebuild recomputes all tiles from the
+  // given system's particles and objects, and update recomputes the
+  // contributions of the given particles, which must belong to the system last
+  // rebuilt. clear removes all tiles.
+  void rebuild(const System& system);
+  void update(const std::vector<const Particle*>& changed);
+  void clear();
+
+  // Returns the number of objects of the system last rebuilt.
+  unsigned int numObjects() const;
+
+  // Draws the tiles with the current projection and modelview matrices.
+  void draw(QOpenGLFunctions_2_0* glfn);
+
+  // Counters of the work done by draw since the last call to resetStats, for
+  // benchmarking: the number of draw calls issued and the number of bytes of
+  // vertex data passed to OpenGL, which copies the client-side arrays on every
+  // draw.
+  int drawCalls() const;
+  qint64 uploadedBytes() const;
+  void resetStats();
+
+ protected:
+  struct Tile {
+    int count;
+    std::unordered_map<int, int> colorCounts;
+  };
+
+  // Returns the color a particle contributes to its tile: its head mark color
+  // if it has one and black (the color of its body) otherwise.
+  static int colorOf(const Particle& p);
+
+  // Adds (resp., removes) one particle or object of the given color to (resp.,
+  // from) the tile with the given key. tileKey returns the key of the tile
+  // containing the given node.
+  void add(qint64 key, int color);
+  void remove(qint64 key, int color);
+  static qint64 tileKey(const Node& node);
+
+  // Regenerates the vertex and color arrays from the tiles; this takes time
+  // linear in the number of tiles, which is much smaller than the number of
+  // particles.
+  void generateQuads();
+
+  // Tiles are squares of 2^tileShift by 2^tileShift nodes.
+  static constexpr int tileShift = 2;
+
+  std::unordered_map<qint64, Tile> tiles;
+  std::unordered_map<const Particle*, std::pair<qint64, int>> contributions;
+  unsigned int _numObjects;
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLubyte> colors;
+  bool quadsDirty;
+
+  int _drawCalls;
+  qint64 _uploadedBytes;
+};
+
+#endif  // AMOEBOTSIM_UI_DENSITYRENDERER_H_
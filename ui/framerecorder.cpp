@@ -0,0 +1,160 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/framerecorder.h"
+
+#include <algorithm>
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrent>
+
+FrameRecorder::FrameRecorder(const QString& filePath, Format format,
+                             Overflow overflow, int capacity, int numDigits)
+    : filePath(filePath),
+      format(format),
+      overflow(overflow),
+      capacity(std::max(1, capacity)),
+      numDigits(numDigits),
+      nextIndex(0),
+      _numWritten(0),
+      _numDropped(0),
+      finishing(false),
+      failed(false),
+      opened(true) {
+  // The raw stream must be written in order, so it has a single encoder.
+  int numEncoders = 1;
+  if (format == Format::Raw) {
+    rawFile.setFileName(filePath + ".raw");
+    if (!rawFile.open(QIODevice::WriteOnly)) {
+      opened = false;
+      finishing = true;
+      return;
+    }
+  } else {
+    numEncoders = std::max(1, QThread::idealThreadCount() - 1);
+  }
+
+  encoders.setMaxThreadCount(numEncoders);
+  for (int i = 0; i < numEncoders; ++i) {
+    futures.push_back(QtConcurrent::run(&encoders, [this]() { encode(); }));
+  }
+}
+
+FrameRecorder::~FrameRecorder() {
+  finish();
+}
+
+bool FrameRecorder::isOpen() const {
+  return opened;
+}
+
+bool FrameRecorder::addFrame(const QImage& frame) {
+  QMutexLocker locker(&mutex);
+  Q_ASSERT(!finishing);
+  const int index = nextIndex++;
+  if (overflow == Overflow::Block) {
+    while (static_cast<int>(queue.size()) >= capacity) {
+      notFull.wait(&mutex);
+    }
+  } else if (static_cast<int>(queue.size()) >= capacity) {
+    ++_numDropped;
+    return false;
+  }
+
+  queue.push_back(std::make_pair(index, frame));
+  notEmpty.wakeOne();
+  return true;
+}
+
+bool FrameRecorder::isFull() const {
+  QMutexLocker locker(&mutex);
+  return static_cast<int>(queue.size()) >= capacity;
+}
+
+void FrameRecorder::skipFrame() {
+  QMutexLocker locker(&mutex);
+  ++nextIndex;
+  ++_numDropped;
+}
+
+bool FrameRecorder::finish() {
+  {
+    QMutexLocker locker(&mutex);
+    finishing = true;
+    notEmpty.wakeAll();
+  }
+
+  for (QFuture<void>& future : futures) {
+    future.waitForFinished();
+  }
+  futures.clear();
+
+  if (rawFile.isOpen()) {
+    rawFile.close();
+  }
+
+  QMutexLocker locker(&mutex);
+  return !failed && opened;
+}
+
+int FrameRecorder::numWritten() const {
+  QMutexLocker locker(&mutex);
+  return _numWritten;
+}
+
+int FrameRecorder::numDropped() const {
+  QMutexLocker locker(&mutex);
+  return _numDropped;
+}
+
+void FrameRecorder::encode() {
+  while (true) {
+    QMutexLocker locker(&mutex);
+    while (queue.empty() && !finishing) {
+      notEmpty.wait(&mutex);
+    }
+    if (queue.empty()) {
+      return;
+    }
+    const std::pair<int, QImage> frame = queue.front();
+    queue.pop_front();
+    notFull.wakeOne();
+    locker.unlock();
+
+    const bool written = write(frame.first, frame.second);
+
+    locker.relock();
+    if (written) {
+      ++_numWritten;
+    } else {
+      failed = true;
+    }
+  }
+}
+
+bool FrameRecorder::write(int index, const QImage& frame) {
+  if (format == Format::Png) {
+    return frame.save(QString("%1%2.png").arg(filePath)
+                                         .arg(index, numDigits, 10, QChar('0')));
+  }
+
+  // Only the single raw encoder thread gets here, so rawSize needs no lock.
+  if (rawSize.isEmpty()) {
+    rawSize = frame.size();
+  }
+  QImage pixels = frame.convertToFormat(QImage::Format_RGBA8888);
+  if (pixels.size() != rawSize) {
+    pixels = pixels.scaled(rawSize, Qt::IgnoreAspectRatio,
+                           Qt::SmoothTransformation);
+  }
+  const int rowBytes = 4 * rawSize.width();
+  for (int y = 0; y < rawSize.height(); ++y) {
+    if (rawFile.write(reinterpret_cast<const char*>(pixels.constScanLine(y)),
+                      rowBytes) != rowBytes) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,101 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Records a sequence of frames in the background. Frames go into a bounded
+// queue, and encoder threads drain it, so the simulation does not wait for
+// image compression. Frames are written either as a numbered PNG sequence,
+// encoded in parallel, or as one raw RGBA stream written in order. When the
+// queue is full, adding a frame either blocks until an encoder catches up or
+// drops the frame.
+
+#ifndef AMOEBOTSIM_UI_FRAMERECORDER_H_
+#define AMOEBOTSIM_UI_FRAMERECORDER_H_
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <QFile>
+#include <QFuture>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+class FrameRecorder {
+ public:
+  // Png writes frame i to <filePath><i>.png, with i padded with leading zeroes
+  // to the given number of digits. Raw writes every frame to
+  // <filePath>.raw as width * height RGBA pixels (8 bits per channel, rows top
+  // to bottom). Every frame has the size of the first frame, and frames of
+  // other sizes are scaled. Such a stream can be read by most video tools,
+  // e.g., ffmpeg -f rawvideo -pixel_format rgba -video_size <w>x<h>.
+  enum class Format { Png, Raw };
+
+  // Block makes addFrame wait for a free slot in a full queue. Drop makes it
+  // discard the frame instead.
+  enum class Overflow { Block, Drop };
+
+  // Starts the encoder threads. PNG frames are encoded by all but one of the
+  // ideal number of threads, leaving one for the simulation. The raw stream is
+  // written by a single thread. The queue holds at most the given number of
+  // frames.
+  FrameRecorder(const QString& filePath, Format format, Overflow overflow,
+                int capacity, int numDigits = 0);
+  ~FrameRecorder();
+
+  // Returns false if the raw stream could not be opened.
+  bool isOpen() const;
+
+  // Functions for adding frames. Frames are numbered in the order they are
+  // added, including dropped ones, so gaps in a PNG sequence show where frames
+  // were dropped. addFrame returns false if the frame was dropped. isFull
+  // lets callers skip grabbing a frame that would be dropped anyway;
+  // skipFrame then only advances the numbering.
+  bool addFrame(const QImage& frame);
+  bool isFull() const;
+  void skipFrame();
+
+  // Waits until all queued frames are written and stops the encoder threads.
+  // No frames can be added afterwards. Returns false if any frame could not be
+  // written.
+  bool finish();
+
+  // Returns the number of frames written (resp., dropped) so far.
+  int numWritten() const;
+  int numDropped() const;
+
+ protected:
+  // Takes frames from the queue and writes them until the queue is empty and
+  // the recording is finished. Runs on each encoder thread.
+  void encode();
+  bool write(int index, const QImage& frame);
+
+  const QString filePath;
+  const Format format;
+  const Overflow overflow;
+  const int capacity;
+  const int numDigits;
+
+  mutable QMutex mutex;
+  QWaitCondition notEmpty;
+  QWaitCondition notFull;
+  std::deque<std::pair<int, QImage>> queue;
+  int nextIndex;
+  int _numWritten;
+  int _numDropped;
+  bool finishing;
+  bool failed;
+  bool opened;
+
+  QFile rawFile;
+  QSize rawSize;
+
+  QThreadPool encoders;
+  std::vector<QFuture<void>> futures;
+};
+
+#endif  // AMOEBOTSIM_UI_FRAMERECORDER_H_
@@ -60,49 +60,5 @@ void ParameterListModel::updateAlgParameters(QString algName) {
 }
 
 void ParameterListModel::createSystem(QString algName) {
-  QStringList defaults = _algs->getParameterDefaults(algName);
-
-  QString signature;
-  std::vector<QString> params;
-  Algorithm* alg = _algs->getAlg(algName);
-  signature = _algs->getAlgSignature(algName);
-  for (int i = 0; i < _values.size(); ++i) {
-    if (_values[i].compare("") != 0) {
-      params.push_back(_values[i]);
-    } else {
-      params.push_back(defaults[i]);
-    }
-  }
-
-  if (signature == "discodemo") {
-    dynamic_cast<DiscoDemoAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toInt());
-  } else if (signature == "metricsdemo") {
-    dynamic_cast<MetricsDemoAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toInt());
-  } else if (signature == "ballroomdemo") {
-    dynamic_cast<BallroomDemoAlg*>(alg)->
-        instantiate(params[0].toInt());
-  } else if (signature == "tokendemo") {
-    dynamic_cast<TokenDemoAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toInt());
-  } else if (signature == "compression") {
-    dynamic_cast<CompressionAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toDouble());
-  } else if (signature == "infobjcoating") {
-    dynamic_cast<InfObjCoatingAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toDouble());
-  } else if (signature == "shapeformation") {
-    dynamic_cast<ShapeFormationAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toDouble(), params[2]);
-  } else if (signature == "leaderelection") {
-    dynamic_cast<LeaderElectionAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toDouble());
-  } else if (signature == "trianglerotate") {
-    dynamic_cast<TriangleRotationAlg*>(alg)->
-        instantiate(params[0].toInt(), params[1].toInt());
-  } else {
-    // An unrecognized signature has been entered.
-    Q_ASSERT(false);
-  }
+  _algs->getAlg(algName)->instantiateWith(_values);
 }
@@ -0,0 +1,460 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/particlerenderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include <QOpenGLContext>
+#include <QRgb>
+#include <QtGlobal>
+
+const double ParticleRenderer::triangleHeight = sqrt(3.0 / 4.0);
+
+// These values are a consequence of how the particle texture was created. The
+// expression (90.0 / 96.0) is done to handle the conversion between 90 dpi and
+// 96 dpi that Inkscape does when exporting the particle.svg as a .png.
+static const char* vertexShaderSource =
+    "#version 120\n"
+    "attribute vec2 corner;\n"
+    "attribute vec2 position;\n"
+    "attribute float cell;\n"
+    "attribute vec4 color;\n"
+    "varying vec2 texCoord;\n"
+    "varying vec4 tint;\n"
+    "const float texSize = 8.0;\n"
+    "const float invTexSize = (90.0 / 96.0) / texSize;\n"
+    "const float halfQuadSideLength = 256.0 / 220.0;\n"
+    "void main() {\n"
+    "  if (cell < 0.0) {\n"
+    "    texCoord = vec2(0.0);\n"
+    "    tint = vec4(0.0);\n"
+    "    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+    "    return;\n"
+    "  }\n"
+    "  float index = floor(cell + 0.5);\n"
+    "  vec2 texOffset = vec2(mod(index, texSize), floor(index / texSize));\n"
+    "  texCoord = (texOffset + 0.5 * (corner + 1.0)) * invTexSize;\n"
+    "  tint = color;\n"
+    "  vec2 pos = position + halfQuadSideLength * corner;\n"
+    "  gl_Position = gl_ModelViewProjectionMatrix * vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* fragmentShaderSource =
+    "#version 120\n"
+    "uniform sampler2D atlas;\n"
+    "varying vec2 texCoord;\n"
+    "varying vec4 tint;\n"
+    "void main() {\n"
+    "  gl_FragColor = texture2D(atlas, texCoord) * tint;\n"
+    "}\n";
+
+// The corners of a sprite's quad, in counter-clockwise order.
+static const GLfloat quadCorners[8] = {-1, -1, 1, -1, 1, 1, -1, 1};
+
+ParticleRenderer::ParticleRenderer()
+    : glfn(nullptr),
+      vertexAttribDivisor(nullptr),
+      drawArraysInstanced(nullptr),
+      cornerBuffer(QOpenGLBuffer::VertexBuffer),
+      instanceBuffer(QOpenGLBuffer::VertexBuffer),
+      objectBuffer(QOpenGLBuffer::VertexBuffer),
+      cornerLoc(-1),
+      positionLoc(-1),
+      cellLoc(-1),
+      colorLoc(-1),
+      _numParticles(0),
+      allDirty(true),
+      objectsDirty(true),
+      _drawCalls(0),
+      _uploadedBytes(0) {}
+
+void ParticleRenderer::initialize(QOpenGLFunctions_2_0* glfn) {
+  this->glfn = glfn;
+
+  program = std::unique_ptr<QOpenGLShaderProgram>(new QOpenGLShaderProgram());
+  program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
+  program->addShaderFromSourceCode(QOpenGLShader::Fragment,
+                                   fragmentShaderSource);
+  bool linked = program->link();
+  Q_ASSERT(linked);
+  Q_UNUSED(linked);
+  cornerLoc = program->attributeLocation("corner");
+  positionLoc = program->attributeLocation("position");
+  cellLoc = program->attributeLocation("cell");
+  colorLoc = program->attributeLocation("color");
+
+  cornerBuffer.create();
+  cornerBuffer.bind();
+  cornerBuffer.allocate(quadCorners, sizeof(quadCorners));
+  cornerBuffer.release();
+
+  instanceBuffer.create();
+  instanceBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  allDirty = true;
+
+  objectBuffer.create();
+  objectBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+  objectsDirty = true;
+
+  // Instancing is core since OpenGL 3.3 and available through
+  // ARB_instanced_arrays before that.
+  QOpenGLContext* context = QOpenGLContext::currentContext();
+  Q_ASSERT(context != nullptr);
+  vertexAttribDivisor = nullptr;
+  drawArraysInstanced = nullptr;
+  if (context->format().version() >= qMakePair(3, 3)) {
+    vertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFn>(
+        context->getProcAddress("glVertexAttribDivisor"));
+    drawArraysInstanced = reinterpret_cast<DrawArraysInstancedFn>(
+        context->getProcAddress("glDrawArraysInstanced"));
+  } else if (context->hasExtension("GL_ARB_instanced_arrays")) {
+    vertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFn>(
+        context->getProcAddress("glVertexAttribDivisorARB"));
+    drawArraysInstanced = reinterpret_cast<DrawArraysInstancedFn>(
+        context->getProcAddress("glDrawArraysInstancedARB"));
+  }
+  if (vertexAttribDivisor == nullptr || drawArraysInstanced == nullptr) {
+    vertexAttribDivisor = nullptr;
+    drawArraysInstanced = nullptr;
+  }
+}
+
+void ParticleRenderer::deinitialize() {
+  objectBuffer.destroy();
+  instanceBuffer.destroy();
+  cornerBuffer.destroy();
+  program = nullptr;
+  glfn = nullptr;
+}
+
+bool ParticleRenderer::isInitialized() const {
+  return program != nullptr;
+}
+
+bool ParticleRenderer::isInstanced() const {
+  return drawArraysInstanced != nullptr;
+}
+
+void ParticleRenderer::rebuild(const std::vector<const Particle*>& particles) {
+  allDirty = true;
+  _numParticles = particles.size();
+  const int numSlots = numMarkSlots + 1 + numBorderSlots + numBorderPointSlots;
+  instances.resize(numSlots * _numParticles);
+
+  slots.clear();
+  slots.reserve(_numParticles);
+  for (unsigned int i = 0; i < _numParticles; ++i) {
+    slots[particles[i]] = i;
+    writeParticle(i, *particles[i]);
+  }
+
+  dirtyRanges.clear();
+}
+
+void ParticleRenderer::update(const std::vector<const Particle*>& changed) {
+  for (const Particle* p : changed) {
+    auto it = slots.find(p);
+    if (it != slots.end()) {
+      writeParticle(it->second, *p);
+    }
+  }
+}
+
+void ParticleRenderer::setObjects(const std::deque<Object*>& objects) {
+  objectInstances.resize(objects.size());
+  for (unsigned int i = 0; i < objects.size(); ++i) {
+    setSprite(objectInstances[i], 0x000000, nodeToWorldCoord(objects[i]->_node),
+              39, 255);
+  }
+  objectsDirty = true;
+}
+
+void ParticleRenderer::clear() {
+  _numParticles = 0;
+  instances.clear();
+  slots.clear();
+  dirtyRanges.clear();
+  allDirty = true;
+  objectInstances.clear();
+  objectsDirty = true;
+}
+
+bool ParticleRenderer::hasSlot(const Particle* particle) const {
+  return slots.find(particle) != slots.end();
+}
+
+unsigned int ParticleRenderer::numParticles() const {
+  return _numParticles;
+}
+
+unsigned int ParticleRenderer::numObjects() const {
+  return objectInstances.size();
+}
+
+void ParticleRenderer::draw(QOpenGLTexture* atlas) {
+  Q_ASSERT(isInitialized());
+
+  // Objects never move, so their buffer is only uploaded when they are set.
+  if (allDirty) {
+    uploadAll(instanceBuffer, instances);
+    dirtyRanges.clear();
+    allDirty = false;
+  } else if (!dirtyRanges.empty()) {
+    uploadDirty();
+  }
+  if (objectsDirty) {
+    uploadAll(objectBuffer, objectInstances);
+    objectsDirty = false;
+  }
+
+  if (instances.empty() && objectInstances.empty()) {
+    return;
+  }
+
+  program->bind();
+  atlas->bind(0);
+  program->setUniformValue("atlas", 0);
+  drawBuffer(instanceBuffer, instances.size());
+  drawBuffer(objectBuffer, objectInstances.size());
+  program->release();
+}
+
+int ParticleRenderer::drawCalls() const {
+  return _drawCalls;
+}
+
+qint64 ParticleRenderer::uploadedBytes() const {
+  return _uploadedBytes;
+}
+
+void ParticleRenderer::resetStats() {
+  _drawCalls = 0;
+  _uploadedBytes = 0;
+}
+
+QPointF ParticleRenderer::nodeToWorldCoord(const Node& node) {
+  return QPointF(node.x + 0.5 * node.y, node.y * triangleHeight);
+}
+
+void ParticleRenderer::latticeRange(const QRectF& rect, int& xMin, int& xMax,
+                                    int& yMin, int& yMax) {
+  // A node's world coordinates are (x + y / 2, y * triangleHeight), so the
+  // rectangle is covered by the parallelogram below. The slack accounts for
+  // sprites extending beyond their node and for expanded particles.
+  static constexpr int slack = 2;
+  yMin = static_cast<int>(std::floor(rect.top() / triangleHeight)) - slack;
+  yMax = static_cast<int>(std::ceil(rect.bottom() / triangleHeight)) + slack;
+  xMin = static_cast<int>(std::floor(rect.left() - 0.5 * yMax)) - slack;
+  xMax = static_cast<int>(std::ceil(rect.right() - 0.5 * yMin)) + slack;
+}
+
+void ParticleRenderer::writeParticle(int index, const Particle& p) {
+  // Slots are grouped by layer, so a particle's sprites are spread over four
+  // ranges of the buffer.
+  const int n = _numParticles;
+  Instance* marks = instances.data() + numMarkSlots * index;
+  Instance* body = instances.data() + numMarkSlots * n + index;
+  Instance* borders = instances.data() + (numMarkSlots + 1) * n
+                      + numBorderSlots * index;
+  Instance* borderPoints = instances.data()
+                           + (numMarkSlots + 1 + numBorderSlots) * n
+                           + numBorderPointSlots * index;
+  const QPointF headPos = nodeToWorldCoord(p.head);
+
+  const int headMarkColor = p.headMarkColor();
+  if (headMarkColor != -1) {
+    setSprite(marks[0], headMarkColor, headPos, p.headMarkGlobalDir() + 8, 180);
+  } else {
+    hideSprite(marks[0]);
+  }
+  const int tailMarkColor = (p.globalTailDir != -1) ? p.tailMarkColor() : -1;
+  if (tailMarkColor > -1) {
+    setSprite(marks[1], tailMarkColor, nodeToWorldCoord(p.tail()),
+              p.tailMarkGlobalDir() + 8, 180);
+  } else {
+    hideSprite(marks[1]);
+  }
+
+  setSprite(*body, 0x000000, headPos, p.globalTailDir + 1, 255);
+
+  const std::array<int, 18> borderColors = p.borderColors();
+  for (int i = 0; i < numBorderSlots; ++i) {
+    if (borderColors[i] != -1) {
+      setSprite(borders[i], borderColors[i], headPos, i + 21, 180);
+    } else {
+      hideSprite(borders[i]);
+    }
+  }
+
+  const std::array<int, 6> borderPointColors = p.borderPointColors();
+  for (int i = 0; i < numBorderPointSlots; ++i) {
+    if (borderPointColors[i] != -1) {
+      setSprite(borderPoints[i], borderPointColors[i], headPos, i + 15, 255);
+    } else {
+      hideSprite(borderPoints[i]);
+    }
+  }
+
+  if (!allDirty) {
+    markDirty(marks - instances.data(), numMarkSlots);
+    markDirty(body - instances.data(), 1);
+    markDirty(borders - instances.data(), numBorderSlots);
+    markDirty(borderPoints - instances.data(), numBorderPointSlots);
+  }
+}
+
+void ParticleRenderer::setSprite(Instance& instance, int color,
+                                 const QPointF& pos, int cell, int alpha) {
+  instance.x = pos.x();
+  instance.y = pos.y();
+  instance.cell = cell;
+  instance.color[0] = qRed(color);
+  instance.color[1] = qGreen(color);
+  instance.color[2] = qBlue(color);
+  instance.color[3] = alpha;
+}
+
+void ParticleRenderer::hideSprite(Instance& instance) {
+  instance.x = 0;
+  instance.y = 0;
+  instance.cell = -1;
+  instance.color[0] = instance.color[1] = instance.color[2] = 0;
+  instance.color[3] = 0;
+}
+
+void ParticleRenderer::markDirty(int first, int count) {
+  dirtyRanges.push_back(std::make_pair(first, count));
+}
+
+void ParticleRenderer::uploadAll(QOpenGLBuffer& buffer,
+                                 const std::vector<Instance>& source) {
+  buffer.bind();
+  if (isInstanced()) {
+    buffer.allocate(source.data(), source.size() * sizeof(Instance));
+    _uploadedBytes += source.size() * sizeof(Instance);
+  } else {
+    quads.clear();
+    expandQuads(source, 0, source.size());
+    buffer.allocate(quads.data(), quads.size() * sizeof(QuadVertex));
+    _uploadedBytes += quads.size() * sizeof(QuadVertex);
+  }
+  buffer.release();
+}
+
+void ParticleRenderer::uploadDirty() {
+  // Merge overlapping and nearby ranges, since a few redundant bytes are much
+  // cheaper to upload than an extra call.
+  static constexpr int maxGap = 64;
+  std::sort(dirtyRanges.begin(), dirtyRanges.end());
+  std::vector<std::pair<int, int>> merged;
+  for (const auto& range : dirtyRanges) {
+    if (!merged.empty()
+        && range.first <= merged.back().first + merged.back().second + maxGap) {
+      const int end = std::max(merged.back().first + merged.back().second,
+                               range.first + range.second);
+      merged.back().second = end - merged.back().first;
+    } else {
+      merged.push_back(range);
+    }
+  }
+
+  instanceBuffer.bind();
+  for (const auto& range : merged) {
+    if (isInstanced()) {
+      instanceBuffer.write(range.first * sizeof(Instance),
+                           instances.data() + range.first,
+                           range.second * sizeof(Instance));
+      _uploadedBytes += range.second * sizeof(Instance);
+    } else {
+      quads.clear();
+      expandQuads(instances, range.first, range.second);
+      instanceBuffer.write(4 * range.first * sizeof(QuadVertex), quads.data(),
+                           quads.size() * sizeof(QuadVertex));
+      _uploadedBytes += quads.size() * sizeof(QuadVertex);
+    }
+  }
+  instanceBuffer.release();
+
+  dirtyRanges.clear();
+}
+
+void ParticleRenderer::expandQuads(const std::vector<Instance>& source,
+                                   int first, int count) {
+  for (int i = first; i < first + count; ++i) {
+    for (int corner = 0; corner < 4; ++corner) {
+      QuadVertex vertex;
+      vertex.cornerX = quadCorners[2 * corner];
+      vertex.cornerY = quadCorners[2 * corner + 1];
+      vertex.instance = source[i];
+      quads.push_back(vertex);
+    }
+  }
+}
+
+void ParticleRenderer::drawBuffer(QOpenGLBuffer& buffer, int numInstances) {
+  if (numInstances == 0) {
+    return;
+  }
+
+  if (isInstanced()) {
+    cornerBuffer.bind();
+    program->enableAttributeArray(cornerLoc);
+    program->setAttributeBuffer(cornerLoc, GL_FLOAT, 0, 2);
+    cornerBuffer.release();
+
+    buffer.bind();
+    bindInstanceAttributes(sizeof(Instance), 0, 1);
+    drawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, numInstances);
+  } else {
+    buffer.bind();
+    program->enableAttributeArray(cornerLoc);
+    program->setAttributeBuffer(cornerLoc, GL_FLOAT, 0, 2, sizeof(QuadVertex));
+    bindInstanceAttributes(sizeof(QuadVertex), offsetof(QuadVertex, instance),
+                           0);
+    glfn->glDrawArrays(GL_QUADS, 0, 4 * numInstances);
+  }
+  ++_drawCalls;
+
+  releaseInstanceAttributes();
+  program->disableAttributeArray(cornerLoc);
+  buffer.release();
+}
+
+void ParticleRenderer::bindInstanceAttributes(int stride, int offset,
+                                              GLuint divisor) {
+  program->enableAttributeArray(positionLoc);
+  program->setAttributeBuffer(positionLoc, GL_FLOAT,
+                              offset + offsetof(Instance, x), 2, stride);
+  program->enableAttributeArray(cellLoc);
+  program->setAttributeBuffer(cellLoc, GL_FLOAT,
+                              offset + offsetof(Instance, cell), 1, stride);
+  program->enableAttributeArray(colorLoc);
+  glfn->glVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+                              reinterpret_cast<const void*>(
+                                  offset + offsetof(Instance, color)));
+
+  if (vertexAttribDivisor != nullptr) {
+    vertexAttribDivisor(positionLoc, divisor);
+    vertexAttribDivisor(cellLoc, divisor);
+    vertexAttribDivisor(colorLoc, divisor);
+  }
+}
+
+void ParticleRenderer::releaseInstanceAttributes() {
+  // Divisors are part of the vertex attribute state, which is shared with the
+  // rest of the scene graph's rendering.
+  if (vertexAttribDivisor != nullptr) {
+    vertexAttribDivisor(positionLoc, 0);
+    vertexAttribDivisor(cellLoc, 0);
+    vertexAttribDivisor(colorLoc, 0);
+  }
+
+  program->disableAttributeArray(positionLoc);
+  program->disableAttributeArray(cellLoc);
+  program->disableAttributeArray(colorLoc);
+}
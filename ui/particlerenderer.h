@@ -0,0 +1,178 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Draws particles and objects as sprites from the particle texture atlas using
+// a shader. Every sprite (a mark, body, border segment, border point, or
+// object) is one 16-byte instance holding its position, atlas cell, and color.
+// The instances are kept in a persistent buffer in which every particle owns a
+// fixed slot per sprite it may draw; unused slots hold hidden sprites. When
+// particles change, only their slots are rewritten and uploaded. Objects are
+// kept in a second buffer that is only uploaded when they change. Each buffer
+// is drawn with a single instanced call. If the OpenGL implementation does not
+// support instancing, the instances are expanded into quads on upload and
+// drawn with the same shader in a single non-instanced call instead.
+
+#ifndef AMOEBOTSIM_UI_PARTICLERENDERER_H_
+#define AMOEBOTSIM_UI_PARTICLERENDERER_H_
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLFunctions_2_0>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QPointF>
+#include <QRectF>
+#include <QtGlobal>
+
+#include "core/object.h"
+#include "core/particle.h"
+
+class ParticleRenderer {
+ public:
+  ParticleRenderer();
+
+  // Compiles the shader and creates the buffers; requires a current OpenGL
+  // context. deinitialize releases them and must be called with the same
+  // context current.
+  void initialize(QOpenGLFunctions_2_0* glfn);
+  void deinitialize();
+  bool isInitialized() const;
+
+  // Returns true if sprites are drawn with instanced calls.
+  bool isInstanced() const;
+
+  // Functions for maintaining the sprites. rebuild recreates the sprites for
+  // the given particles, and update recreates those of the given particles,
+  // skipping particles that were not part of the last rebuild. setObjects
+  // replaces the objects, which are kept in a separate static buffer since
+  // they never move. clear removes all sprites. These only touch memory; the
+  // buffers are updated by the next call to draw. Sprites are drawn in layers,
+  // marks below bodies below borders below border points, followed by
+  // objects. Each particle's virtual appearance functions are called once per
+  // rebuild or update.
+  void rebuild(const std::vector<const Particle*>& particles);
+  void update(const std::vector<const Particle*>& changed);
+  void setObjects(const std::deque<Object*>& objects);
+  void clear();
+
+  // Returns true if the given particle was part of the last rebuild, and the
+  // number of particles of the last rebuild (resp., objects last set).
+  bool hasSlot(const Particle* particle) const;
+  unsigned int numParticles() const;
+  unsigned int numObjects() const;
+
+  // Uploads the changed sprites and draws all sprites with the current
+  // projection and modelview matrices, sampling from the given particle
+  // texture atlas.
+  void draw(QOpenGLTexture* atlas);
+
+  // Counters of the work done by draw since the last call to resetStats, for
+  // benchmarking: the number of draw calls issued and the number of bytes of
+  // vertex data uploaded.
+  int drawCalls() const;
+  qint64 uploadedBytes() const;
+  void resetStats();
+
+  // The height of a triangle in the lattice, whose side length is 1 in world
+  // coordinates.
+  static const double triangleHeight;
+
+  // Returns the world coordinates of the given node's center.
+  static QPointF nodeToWorldCoord(const Node& node);
+
+  // Computes a range of lattice coordinates whose particles include all those
+  // with sprites in the given rectangle of world coordinates. As world
+  // coordinates point up, the rectangle's top() is its lowest y-coordinate.
+  static void latticeRange(const QRectF& rect, int& xMin, int& xMax, int& yMin,
+                           int& yMax);
+
+ protected:
+  struct Instance {
+    GLfloat x, y;
+    GLfloat cell;
+    GLubyte color[4];
+  };
+
+  // A corner of a sprite's quad, used if instancing is not supported.
+  struct QuadVertex {
+    GLfloat cornerX, cornerY;
+    Instance instance;
+  };
+
+  // The number of slots a particle owns in each layer: a head and tail mark, a
+  // body, 18 border segments, and 6 border points.
+  static constexpr int numMarkSlots = 2;
+  static constexpr int numBorderSlots = 18;
+  static constexpr int numBorderPointSlots = 6;
+
+  // Writes the sprites of the particle with the given index to its slots and
+  // marks them for upload.
+  void writeParticle(int index, const Particle& p);
+
+  // Sets the given instance to a sprite of the given 0xrrggbb color and opacity
+  // (0-255), drawing the given atlas cell at the given position; a hidden
+  // sprite is not drawn at all.
+  static void setSprite(Instance& instance, int color, const QPointF& pos,
+                        int cell, int alpha);
+  static void hideSprite(Instance& instance);
+
+  // Marks the given range of instances for upload.
+  void markDirty(int first, int count);
+
+  // uploadAll uploads the given instances to the given buffer, and
+  // uploadDirty uploads the merged dirty ranges of the particle instances to
+  // the instance buffer. Both expand instances into quads (appended to quads by
+  // expandQuads) if instancing is not supported.
+  void uploadAll(QOpenGLBuffer& buffer, const std::vector<Instance>& source);
+  void uploadDirty();
+  void expandQuads(const std::vector<Instance>& source, int first, int count);
+
+  // Draws the given number of instances from the given buffer with the bound
+  // shader program.
+  void drawBuffer(QOpenGLBuffer& buffer, int numInstances);
+
+  // Binds (resp., unbinds) the per-instance attributes of the shader to the
+  // currently bound buffer, given the stride between and offset of instances,
+  // and sets their divisor to the given value if instancing is supported.
+  void bindInstanceAttributes(int stride, int offset, GLuint divisor);
+  void releaseInstanceAttributes();
+
+ protected:
+  typedef void (QOPENGLF_APIENTRYP VertexAttribDivisorFn)(GLuint, GLuint);
+  typedef void (QOPENGLF_APIENTRYP DrawArraysInstancedFn)(GLenum, GLint,
+                                                          GLsizei, GLsizei);
+
+  QOpenGLFunctions_2_0* glfn;
+  VertexAttribDivisorFn vertexAttribDivisor;
+  DrawArraysInstancedFn drawArraysInstanced;
+
+  std::unique_ptr<QOpenGLShaderProgram> program;
+  QOpenGLBuffer cornerBuffer;
+  QOpenGLBuffer instanceBuffer;
+  QOpenGLBuffer objectBuffer;
+  int cornerLoc, positionLoc, cellLoc, colorLoc;
+
+  // The particle sprites in drawing order, the slot index of each particle,
+  // and the ranges of sprites (first, count) that changed since the last
+  // upload, followed by the object sprites.
+  unsigned int _numParticles;
+  std::vector<Instance> instances;
+  std::unordered_map<const Particle*, int> slots;
+  std::vector<std::pair<int, int>> dirtyRanges;
+  bool allDirty;
+  std::vector<Instance> objectInstances;
+  bool objectsDirty;
+  std::vector<QuadVertex> quads;
+
+  int _drawCalls;
+  qint64 _uploadedBytes;
+};
+
+#endif  // AMOEBOTSIM_UI_PARTICLERENDERER_H_
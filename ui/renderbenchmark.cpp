@@ -0,0 +1,216 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/renderbenchmark.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutexLocker>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_2_0>
+#include <QOpenGLTexture>
+#include <QPointF>
+#include <QRectF>
+
+#include "ui/densityrenderer.h"
+#include "ui/particlerenderer.h"
+#include "ui/softwarerenderer.h"
+#include "ui/visitem.h"
+
+RenderBenchmark::RenderBenchmark(const QSize& size, double zoom,
+                                 int stepsPerFrame)
+    : size(size),
+      zoom(zoom),
+      stepsPerFrame(stepsPerFrame) {}
+
+bool RenderBenchmark::runOpenGL(System& system, int numFrames,
+                                Result& result) const {
+  result = Result();
+
+  QOpenGLContext context;
+  if (!context.create()) {
+    return false;
+  }
+  QOffscreenSurface surface;
+  surface.setFormat(context.format());
+  surface.create();
+  if (!surface.isValid() || !context.makeCurrent(&surface)) {
+    return false;
+  }
+  // Context retains ownership.
+  auto glfn = context.versionFunctions<QOpenGLFunctions_2_0>();
+  if (glfn == nullptr || !glfn->initializeOpenGLFunctions()) {
+    context.doneCurrent();
+    return false;
+  }
+
+  QPointF focus;
+  {
+    QMutexLocker locker(&system.mutex);
+    focus = system.centerOfMass();
+  }
+  const double left = focus.x() - 0.5 * size.width() / zoom;
+  const double right = focus.x() + 0.5 * size.width() / zoom;
+  const double bottom = focus.y() - 0.5 * size.height() / zoom;
+  const double top = focus.y() + 0.5 * size.height() / zoom;
+  int xMin, xMax, yMin, yMax;
+  ParticleRenderer::latticeRange(QRectF(QPointF(left, bottom),
+                                        QPointF(right, top)),
+                                 xMin, xMax, yMin, yMax);
+  const bool detail = (zoom >= VisItem::detailZoomMin);
+
+  {
+    // The same resources as VisItem::initialize, minus the grid, which is a
+    // single textured quad.
+    QOpenGLFramebufferObject fbo(size);
+    fbo.bind();
+    QOpenGLTexture particleTex(QImage(":textures/particle.png").mirrored());
+    particleTex.setMinMagFilters(QOpenGLTexture::LinearMipMapLinear,
+                                 QOpenGLTexture::Linear);
+    particleTex.bind();
+    particleTex.generateMipMaps();
+    ParticleRenderer particleRenderer;
+    particleRenderer.initialize(glfn);
+    DensityRenderer densityRenderer;
+
+    std::vector<const Particle*> changed, visible;
+    QElapsedTimer timer;
+    for (int frame = 0; frame < numFrames; ++frame) {
+      if (frame > 0) {
+        step(system);
+      }
+      particleRenderer.resetStats();
+      densityRenderer.resetStats();
+      timer.start();
+
+      // Update the sprites or heatmap as in VisItem::drawParticles and
+      // VisItem::drawDensity; the view never moves.
+      {
+        QMutexLocker locker(&system.mutex);
+        const bool complete = system.takeChanges(changed);
+        if (detail) {
+          bool rebuild = (frame == 0) || !complete;
+          for (unsigned int i = 0; !rebuild && i < changed.size(); ++i) {
+            const Particle* p = changed[i];
+            rebuild = !particleRenderer.hasSlot(p)
+                      && xMin <= p->head.x && p->head.x <= xMax
+                      && yMin <= p->head.y && p->head.y <= yMax;
+          }
+          if (rebuild) {
+            visible.clear();
+            system.particlesInRange(xMin, xMax, yMin, yMax, visible);
+            particleRenderer.rebuild(visible);
+          } else {
+            particleRenderer.update(changed);
+          }
+          if (frame == 0) {
+            particleRenderer.setObjects(system.getObjects());
+          }
+        } else if (frame == 0 || !complete) {
+          densityRenderer.rebuild(system);
+        } else {
+          densityRenderer.update(changed);
+        }
+      }
+
+      glfn->glUseProgram(0);
+      glfn->glViewport(0, 0, size.width(), size.height());
+      glfn->glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+      glfn->glClear(GL_COLOR_BUFFER_BIT);
+      glfn->glDisable(GL_DEPTH_TEST);
+      glfn->glDisable(GL_CULL_FACE);
+      glfn->glEnable(GL_BLEND);
+      glfn->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glfn->glEnable(GL_TEXTURE_2D);
+      glfn->glMatrixMode(GL_MODELVIEW);
+      glfn->glLoadIdentity();
+      glfn->glMatrixMode(GL_PROJECTION);
+      glfn->glLoadIdentity();
+      glfn->glOrtho(left, right, bottom, top, 1, -1);
+      if (detail) {
+        particleRenderer.draw(&particleTex);
+      } else {
+        densityRenderer.draw(glfn);
+      }
+      glfn->glFinish();
+
+      addFrame(result, timer.nsecsElapsed() / 1e6);
+      result.drawCallsPerFrame += particleRenderer.drawCalls()
+                                  + densityRenderer.drawCalls();
+      result.uploadedBytesPerFrame += particleRenderer.uploadedBytes()
+                                      + densityRenderer.uploadedBytes();
+    }
+
+    particleRenderer.deinitialize();
+    fbo.release();
+  }
+  context.doneCurrent();
+
+  {
+    QMutexLocker locker(&system.mutex);
+    system.invalidateChanges();
+  }
+  finish(result);
+  return true;
+}
+
+void RenderBenchmark::runSoftware(System& system, int numFrames,
+                                  Result& result) const {
+  result = Result();
+
+  QPointF focus;
+  {
+    QMutexLocker locker(&system.mutex);
+    focus = system.centerOfMass();
+  }
+
+  SoftwareRenderer renderer;
+  QElapsedTimer timer;
+  for (int frame = 0; frame < numFrames; ++frame) {
+    if (frame > 0) {
+      step(system);
+    }
+    timer.start();
+    renderer.capture(system);
+    renderer.render(focus, zoom, size);
+    addFrame(result, timer.nsecsElapsed() / 1e6);
+  }
+
+  finish(result);
+}
+
+void RenderBenchmark::step(System& system) const {
+  QMutexLocker locker(&system.mutex);
+  if (system.size() == 0) {
+    return;
+  }
+  for (int i = 0; i < stepsPerFrame; ++i) {
+    system.activate();
+  }
+}
+
+void RenderBenchmark::addFrame(Result& result, double ms) {
+  if (result.numFrames == 0) {
+    result.firstFrameMs = ms;
+  } else {
+    result.meanFrameMs += ms;
+    result.maxFrameMs = std::max(result.maxFrameMs, ms);
+  }
+  ++result.numFrames;
+}
+
+void RenderBenchmark::finish(Result& result) {
+  if (result.numFrames > 1) {
+    result.meanFrameMs /= result.numFrames - 1;
+  }
+  if (result.numFrames > 0) {
+    result.drawCallsPerFrame /= result.numFrames;
+    result.uploadedBytesPerFrame /= result.numFrames;
+  }
+}
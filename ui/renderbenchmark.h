@@ -0,0 +1,62 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Measures how fast a system is rendered, so that rendering optimizations can
+// be quantified and regressions caught. Frames are rendered offscreen, either
+// with the OpenGL renderers VisItem uses or with the SoftwareRenderer. The
+// camera is fixed on the system's center of mass, and the system can be
+// stepped between frames to exercise the incremental update paths.
+
+#ifndef AMOEBOTSIM_UI_RENDERBENCHMARK_H_
+#define AMOEBOTSIM_UI_RENDERBENCHMARK_H_
+
+#include <QSize>
+#include <QtGlobal>
+
+#include "core/system.h"
+
+class RenderBenchmark {
+ public:
+  // The first frame builds everything from scratch and is timed separately
+  // from the remaining ones. Draw calls and uploaded bytes are averaged over
+  // all frames and are zero for the SoftwareRenderer.
+  struct Result {
+    int numFrames;
+    double firstFrameMs;
+    double meanFrameMs;
+    double maxFrameMs;
+    double drawCallsPerFrame;
+    double uploadedBytesPerFrame;
+  };
+
+  // Constructs a benchmark rendering frames of the given size at the given zoom
+  // (in pixels per unit of length), activating the given number of particles
+  // before every frame but the first.
+  RenderBenchmark(const QSize& size, double zoom, int stepsPerFrame);
+
+  // Renders the given number of frames of the given system. runOpenGL draws
+  // with the same renderers and level of detail as VisItem into an offscreen
+  // framebuffer, waiting for each frame to finish. It returns false if no
+  // OpenGL context could be created. runSoftware captures and renders each
+  // frame with the SoftwareRenderer. runOpenGL consumes the system's change
+  // journal like VisItem does and invalidates it when done.
+  bool runOpenGL(System& system, int numFrames, Result& result) const;
+  void runSoftware(System& system, int numFrames, Result& result) const;
+
+ protected:
+  // Activates stepsPerFrame particles of the given system.
+  void step(System& system) const;
+
+  // Functions for accumulating results. addFrame adds the given frame time to
+  // the result and increments its frame count, and finish turns the
+  // accumulated sums into averages.
+  static void addFrame(Result& result, double ms);
+  static void finish(Result& result);
+
+  const QSize size;
+  const double zoom;
+  const int stepsPerFrame;
+};
+
+#endif  // AMOEBOTSIM_UI_RENDERBENCHMARK_H_
@@ -0,0 +1,308 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/softwarerenderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <QBrush>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QThread>
+#include <QTransform>
+#include <QtConcurrent>
+
+#include "core/object.h"
+#include "core/particle.h"
+#include "ui/particlerenderer.h"
+
+// The geometry of the particle texture atlas; see the shader in
+// particlerenderer.cpp.
+static constexpr int texSize = 8;
+static constexpr double invTexSize = (90.0 / 96.0) / texSize;
+static constexpr double halfQuadSideLength = 256.0 / 220.0;
+
+// zoom below which the grid is not drawn, which is where VisItem switches to
+// its density heatmap
+static constexpr double gridZoomMin = 4.0;
+
+// Returns a copy of the given premultiplied image multiplied by the given
+// color, like the shader tints atlas cells.
+static QImage tinted(const QImage& image, QRgb color) {
+  QImage result = image;
+  const int r = qRed(color), g = qGreen(color), b = qBlue(color);
+  const int a = qAlpha(color);
+  for (int y = 0; y < result.height(); ++y) {
+    QRgb* line = reinterpret_cast<QRgb*>(result.scanLine(y));
+    for (int x = 0; x < result.width(); ++x) {
+      const QRgb p = line[x];
+      line[x] = qRgba(qRed(p) * r * a / (255 * 255),
+                      qGreen(p) * g * a / (255 * 255),
+                      qBlue(p) * b * a / (255 * 255), qAlpha(p) * a / 255);
+    }
+  }
+  return result;
+}
+
+SoftwareRenderer::SoftwareRenderer()
+    : atlas(QImage(":textures/particle.png")
+                .convertToFormat(QImage::Format_ARGB32_Premultiplied)),
+      gridTex(QImage(":/textures/grid.png")) {}
+
+void SoftwareRenderer::capture(System& system) {
+  for (auto& layer : layers) {
+    layer.clear();
+  }
+
+  {
+    QMutexLocker locker(&system.mutex);
+    for (const Particle& p : system) {
+      const QPointF headPos = ParticleRenderer::nodeToWorldCoord(p.head);
+
+      const int headMarkColor = p.headMarkColor();
+      if (headMarkColor != -1) {
+        addSprite(0, headPos, p.headMarkGlobalDir() + 8, headMarkColor, 180);
+      }
+      const int tailMarkColor = (p.globalTailDir != -1) ? p.tailMarkColor() : -1;
+      if (tailMarkColor > -1) {
+        addSprite(0, ParticleRenderer::nodeToWorldCoord(p.tail()),
+                  p.tailMarkGlobalDir() + 8, tailMarkColor, 180);
+      }
+
+      addSprite(1, headPos, p.globalTailDir + 1, 0x000000, 255);
+
+      const std::array<int, 18> borderColors = p.borderColors();
+      for (int i = 0; i < 18; ++i) {
+        if (borderColors[i] != -1) {
+          addSprite(2, headPos, i + 21, borderColors[i], 180);
+        }
+      }
+
+      const std::array<int, 6> borderPointColors = p.borderPointColors();
+      for (int i = 0; i < 6; ++i) {
+        if (borderPointColors[i] != -1) {
+          addSprite(3, headPos, i + 15, borderPointColors[i], 255);
+        }
+      }
+    }
+
+    for (const Object* o : system.getObjects()) {
+      addSprite(4, ParticleRenderer::nodeToWorldCoord(o->_node), 39, 0x000000,
+                255);
+    }
+  }
+
+  for (auto& layer : layers) {
+    std::stable_sort(layer.begin(), layer.end(),
+                     [](const Sprite& a, const Sprite& b) {
+                       return a.y < b.y;
+                     });
+  }
+}
+
+QRectF SoftwareRenderer::bounds() const {
+  bool empty = true;
+  float xMin = 0, xMax = 0, yMin = 0, yMax = 0;
+  for (const auto& layer : layers) {
+    if (layer.empty()) {
+      continue;
+    }
+    // Layers are sorted by y, so only their x-coordinates need a full pass.
+    const auto xs = std::minmax_element(layer.begin(), layer.end(),
+                                        [](const Sprite& a, const Sprite& b) {
+                                          return a.x < b.x;
+                                        });
+    if (empty) {
+      xMin = xs.first->x;
+      xMax = xs.second->x;
+      yMin = layer.front().y;
+      yMax = layer.back().y;
+      empty = false;
+    } else {
+      xMin = std::min(xMin, xs.first->x);
+      xMax = std::max(xMax, xs.second->x);
+      yMin = std::min(yMin, layer.front().y);
+      yMax = std::max(yMax, layer.back().y);
+    }
+  }
+
+  if (empty) {
+    return QRectF();
+  }
+  return QRectF(QPointF(xMin - halfQuadSideLength, yMin - halfQuadSideLength),
+                QPointF(xMax + halfQuadSideLength, yMax + halfQuadSideLength));
+}
+
+double SoftwareRenderer::zoomToFit(const QSize& size) const {
+  const QRectF rect = bounds();
+  if (rect.isNull() || size.isEmpty()) {
+    return 16.0;
+  }
+  return std::min(size.width() / rect.width(), size.height() / rect.height());
+}
+
+QImage SoftwareRenderer::render(const QPointF& focus, double zoom,
+                                const QSize& size) const {
+  Q_ASSERT(zoom > 0);
+  QImage image(size, QImage::Format_ARGB32_Premultiplied);
+  if (image.isNull()) {
+    return image;
+  }
+
+  const double left = focus.x() - 0.5 * size.width() / zoom;
+  const double top = focus.y() + 0.5 * size.height() / zoom;
+  renderImage(image, left, top, QPoint(0, 0), zoom, prepareSprites(zoom));
+  return image;
+}
+
+bool SoftwareRenderer::renderTiles(const QPointF& focus, double zoom,
+                                   const QSize& size, const QSize& tileSize,
+                                   const QString& filePrefix) const {
+  Q_ASSERT(zoom > 0);
+  Q_ASSERT(!tileSize.isEmpty());
+  const double left = focus.x() - 0.5 * size.width() / zoom;
+  const double top = focus.y() + 0.5 * size.height() / zoom;
+  const SpriteCache cache = prepareSprites(zoom);
+
+  for (int row = 0; row * tileSize.height() < size.height(); ++row) {
+    for (int col = 0; col * tileSize.width() < size.width(); ++col) {
+      const QPoint offset(col * tileSize.width(), row * tileSize.height());
+      QImage tile(std::min(tileSize.width(), size.width() - offset.x()),
+                  std::min(tileSize.height(), size.height() - offset.y()),
+                  QImage::Format_ARGB32_Premultiplied);
+      if (tile.isNull()) {
+        return false;
+      }
+      renderImage(tile, left, top, offset, zoom, cache);
+      const QString filePath = QString("%1_%2_%3.png").arg(filePrefix)
+                                                      .arg(row).arg(col);
+      if (!tile.save(filePath)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void SoftwareRenderer::addSprite(int layer, const QPointF& pos, int cell,
+                                 int color, int alpha) {
+  Sprite sprite;
+  sprite.x = pos.x();
+  sprite.y = pos.y();
+  sprite.cell = cell;
+  sprite.color = qRgba(qRed(color), qGreen(color), qBlue(color), alpha);
+  layers[layer].push_back(sprite);
+}
+
+SoftwareRenderer::SpriteCache SoftwareRenderer::prepareSprites(
+    double zoom) const {
+  const int spriteSize = std::max(1, qRound(2.0 * halfQuadSideLength * zoom));
+  const int cellSize = qRound(atlas.width() * invTexSize);
+
+  std::unordered_map<int, QImage> cells;
+  SpriteCache cache;
+  for (const auto& layer : layers) {
+    for (const Sprite& sprite : layer) {
+      const quint64 key = spriteKey(sprite.cell, sprite.color);
+      if (cache.find(key) != cache.end()) {
+        continue;
+      }
+
+      auto it = cells.find(sprite.cell);
+      if (it == cells.end()) {
+        // Cells are counted from the bottom left of the atlas, since the
+        // texture is uploaded mirrored (see VisItem::initialize).
+        const QRect rect((sprite.cell % texSize) * cellSize,
+                         atlas.height() - (sprite.cell / texSize + 1) * cellSize,
+                         cellSize, cellSize);
+        const QImage cell = atlas.copy(rect).scaled(spriteSize, spriteSize,
+                                                    Qt::IgnoreAspectRatio,
+                                                    Qt::SmoothTransformation);
+        it = cells.emplace(sprite.cell, cell.convertToFormat(
+                               QImage::Format_ARGB32_Premultiplied)).first;
+      }
+      cache[key] = tinted(it->second, sprite.color);
+    }
+  }
+
+  return cache;
+}
+
+quint64 SoftwareRenderer::spriteKey(int cell, QRgb color) {
+  return (static_cast<quint64>(cell) << 32) | color;
+}
+
+void SoftwareRenderer::renderImage(QImage& target, double left, double top,
+                                   const QPoint& offset, double zoom,
+                                   const SpriteCache& cache) const {
+  // The bands paint directly into the target's memory; bits() detaches the
+  // target once, before the bands are created.
+  static constexpr int minBandHeight = 16;
+  uchar* bits = target.bits();
+  const int numBands = std::max(1, std::min(4 * QThread::idealThreadCount(),
+                                            target.height() / minBandHeight));
+  const int bandHeight = (target.height() + numBands - 1) / numBands;
+
+  std::vector<int> bandStarts;
+  for (int y = 0; y < target.height(); y += bandHeight) {
+    bandStarts.push_back(y);
+  }
+
+  QtConcurrent::blockingMap(bandStarts, [&](int& y) {
+    QImage band(bits + static_cast<qint64>(y) * target.bytesPerLine(),
+                target.width(), std::min(bandHeight, target.height() - y),
+                target.bytesPerLine(), target.format());
+    renderBand(band, left, top, offset + QPoint(0, y), zoom, cache);
+  });
+}
+
+void SoftwareRenderer::renderBand(QImage& band, double left, double top,
+                                  const QPoint& offset, double zoom,
+                                  const SpriteCache& cache) const {
+  QPainter painter(&band);
+  painter.fillRect(band.rect(), Qt::white);
+
+  if (zoom >= gridZoomMin) {
+    // Like in VisItem::drawGrid, the grid texture spans one unit of length by
+    // two triangle heights and starts at the world origin.
+    static const double gridTexHeight =
+        2.0 * ParticleRenderer::triangleHeight;
+    QBrush grid(gridTex);
+    grid.setTransform(QTransform(zoom / gridTex.width(), 0, 0,
+                                 gridTexHeight * zoom / gridTex.height(),
+                                 -left * zoom - offset.x(),
+                                 (top - gridTexHeight) * zoom - offset.y()));
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.fillRect(band.rect(), grid);
+  }
+
+  // The world rectangle covered by the band, extended by the size of a sprite.
+  const double bandLeft = left + offset.x() / zoom - halfQuadSideLength;
+  const double bandRight = bandLeft + band.width() / zoom
+                           + 2 * halfQuadSideLength;
+  const double bandTop = top - offset.y() / zoom + halfQuadSideLength;
+  const double bandBottom = bandTop - band.height() / zoom
+                            - 2 * halfQuadSideLength;
+  const double halfSpriteSize =
+      0.5 * std::max(1, qRound(2.0 * halfQuadSideLength * zoom));
+
+  for (const auto& layer : layers) {
+    auto it = std::lower_bound(layer.begin(), layer.end(), bandBottom,
+                               [](const Sprite& sprite, double y) {
+                                 return sprite.y < y;
+                               });
+    for (; it != layer.end() && it->y <= bandTop; ++it) {
+      if (it->x < bandLeft || it->x > bandRight) {
+        continue;
+      }
+      const int x = qRound((it->x - left) * zoom - halfSpriteSize);
+      const int y = qRound((top - it->y) * zoom - halfSpriteSize);
+      painter.drawImage(QPoint(x, y) - offset,
+                        cache.at(spriteKey(it->cell, it->color)));
+    }
+  }
+}
@@ -0,0 +1,101 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Renders a snapshot of a system into an image on the CPU. No OpenGL context
+// or window is needed, so scripts can produce images without a visible window
+// and at resolutions far beyond what a window supports. Sprites come from the
+// same texture atlas as in ParticleRenderer and use the same geometry and
+// layers. The image is split into bands of rows, and the bands are rendered in
+// parallel. Images too large to hold in memory can be rendered as a grid of
+// separate tile images.
+
+#ifndef AMOEBOTSIM_UI_SOFTWARERENDERER_H_
+#define AMOEBOTSIM_UI_SOFTWARERENDERER_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include <QImage>
+#include <QPoint>
+#include <QPointF>
+#include <QRectF>
+#include <QRgb>
+#include <QSize>
+#include <QString>
+#include <QtGlobal>
+
+#include "core/system.h"
+
+class SoftwareRenderer {
+ public:
+  SoftwareRenderer();
+
+  // Copies the sprites of the given system's particles and objects while
+  // holding the system's mutex. Rendering only reads this copy, so the system
+  // can change while an image is rendered.
+  void capture(System& system);
+
+  // bounds returns the world coordinates of the bounding rectangle of the
+  // captured sprites. It is null if nothing was captured. zoomToFit returns
+  // the zoom (in pixels per unit of length) at which these bounds just fit
+  // into an image of the given size.
+  QRectF bounds() const;
+  double zoomToFit(const QSize& size) const;
+
+  // Renders the captured sprites on top of the grid into an image of the
+  // given size. The image is centered at the given world coordinates and drawn
+  // at the given zoom. The grid is only drawn at zooms where the window would
+  // draw individual particles.
+  QImage render(const QPointF& focus, double zoom, const QSize& size) const;
+
+  // Renders the same image as render as a grid of tiles of at most the given
+  // size. Each tile is saved as <filePrefix>_<row>_<column>.png, and only one
+  // tile is kept in memory at a time. Returns false if a tile could not be
+  // saved.
+  bool renderTiles(const QPointF& focus, double zoom, const QSize& size,
+                   const QSize& tileSize, const QString& filePrefix) const;
+
+ protected:
+  struct Sprite {
+    float x, y;
+    int cell;
+    QRgb color;
+  };
+
+  // The layers sprites are drawn in, bottom to top: marks, bodies, borders,
+  // border points, and objects.
+  static constexpr int numLayers = 5;
+
+  // Adds a sprite of the given 0xrrggbb color and opacity (0-255) to the given
+  // layer, drawing the given atlas cell at the given position.
+  void addSprite(int layer, const QPointF& pos, int cell, int color,
+                 int alpha);
+
+  // The captured sprites at the size they have at one zoom, with each atlas
+  // cell scaled and tinted once per color.
+  typedef std::unordered_map<quint64, QImage> SpriteCache;
+  SpriteCache prepareSprites(double zoom) const;
+  static quint64 spriteKey(int cell, QRgb color);
+
+  // Renders the part of an image at the given offset (in pixels) into the
+  // given target. The image's top left corner is at the given world
+  // coordinates. Pixel positions are computed relative to the whole image, so
+  // adjacent parts line up exactly. renderImage splits the target into bands
+  // of rows, and renderBand renders each band on its own thread.
+  void renderImage(QImage& target, double left, double top,
+                   const QPoint& offset, double zoom,
+                   const SpriteCache& cache) const;
+  void renderBand(QImage& band, double left, double top, const QPoint& offset,
+                  double zoom, const SpriteCache& cache) const;
+
+ protected:
+  QImage atlas;
+  QImage gridTex;
+
+  // The captured sprites of each layer, sorted by their y-coordinate so that a
+  // band only looks at the sprites overlapping it.
+  std::vector<Sprite> layers[numLayers];
+};
+
+#endif  // AMOEBOTSIM_UI_SOFTWARERENDERER_H_
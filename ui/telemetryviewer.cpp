@@ -0,0 +1,82 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+#include "ui/telemetryviewer.h"
+
+#include <vector>
+
+#include "core/amoebotparticle.h"
+#include "core/amoebotsystem.h"
+
+namespace {
+
+// A particle that only shows where a particle of the observed system was.
+class TelemetryParticle : public AmoebotParticle {
+ public:
+  TelemetryParticle(const Node& head, int globalTailDir, int color,
+                    AmoebotSystem& system)
+      : AmoebotParticle(head, globalTailDir, 0, system),
+        color(color) {}
+
+  void activate() override {}
+  int headMarkColor() const override { return color; }
+  int tailMarkColor() const override { return color; }
+
+ private:
+  const int color;
+};
+
+class TelemetrySystem : public AmoebotSystem {
+ public:
+  TelemetrySystem(
+      const std::vector<TelemetryReader::SnapshotParticle>& particles,
+      const Telemetry::Sample& sample) {
+    for (const auto& p : particles) {
+      insert(new TelemetryParticle(Node(p.x, p.y), p.globalTailDir, p.color,
+                                   *this));
+    }
+    getCount("# Rounds")._value = sample.rounds;
+    getCount("# Activations")._value = sample.steps;
+  }
+};
+
+}  // namespace
+
+TelemetryViewer::TelemetryViewer(const QString& key, int pollMs)
+    : key(key),
+      reader(key),
+      nextSample(0),
+      snapshotSequence(0),
+      lastSample() {
+  pollTimer.setInterval(pollMs);
+  connect(&pollTimer, &QTimer::timeout, this, &TelemetryViewer::poll);
+}
+
+bool TelemetryViewer::attach() {
+  if (!reader.attach()) {
+    emit log("Could not attach to telemetry \"" + key + "\": " +
+             reader.errorString(), true);
+    return false;
+  }
+  emit log("Attached to telemetry \"" + key + "\"");
+  pollTimer.start();
+  poll();
+  return true;
+}
+
+void TelemetryViewer::poll() {
+  std::vector<Telemetry::Sample> samples;
+  reader.samples(nextSample, samples);
+  if (!samples.empty()) {
+    lastSample = samples.back();
+    emit log(QString("%1 activations, %2 rounds (%3 per second)")
+             .arg(lastSample.steps).arg(lastSample.rounds)
+             .arg(qRound64(lastSample.stepsPerSecond)));
+  }
+
+  std::vector<TelemetryReader::SnapshotParticle> particles;
+  if (reader.snapshot(snapshotSequence, particles)) {
+    emit setSystem(std::make_shared<TelemetrySystem>(particles, lastSample));
+  }
+}
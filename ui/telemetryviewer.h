@@ -0,0 +1,51 @@
+/* Copyright (C) 2020 Joshua J. Daymude, Robert Gmyr, and Kristian Hinnenthal.
+ * The full GNU GPLv3 can be found in the LICENSE file, and the full copyright
+ * notice can be found at the top of main/main.cpp. */
+
+// Shows a simulation running in another process in this simulator's window by
+// reading the telemetry it publishes (see core/telemetry.h). Every new snapshot
+// becomes a system of inert particles with the snapshot's positions and
+// colors, and every new sample is logged like the progress of a bulk run. The
+// window is attached with "AmoebotSim --attach <key>" (see main/application.h).
+
+#ifndef AMOEBOTSIM_UI_TELEMETRYVIEWER_H_
+#define AMOEBOTSIM_UI_TELEMETRYVIEWER_H_
+
+#include <memory>
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "core/system.h"
+#include "core/telemetry.h"
+
+class TelemetryViewer : public QObject {
+  Q_OBJECT
+
+ public:
+  // Constructs a viewer of the telemetry with the given key, polled every
+  // pollMs milliseconds once attached.
+  explicit TelemetryViewer(const QString& key, int pollMs = 250);
+
+  // Attaches to the telemetry and starts polling it. Returns false and logs
+  // the reason if there is no telemetry with this viewer's key.
+  bool attach();
+
+ signals:
+  void setSystem(std::shared_ptr<System> system);
+  void log(const QString msg, bool error = false);
+
+ private:
+  // Reads the samples and the snapshot published since the last poll.
+  void poll();
+
+  const QString key;
+  TelemetryReader reader;
+  QTimer pollTimer;
+  quint64 nextSample;
+  quint64 snapshotSequence;
+  Telemetry::Sample lastSample;
+};
+
+#endif  // AMOEBOTSIM_UI_TELEMETRYVIEWER_H_
@@ -10,7 +10,7 @@
 
 // Zoom preferences.
 static constexpr double zoomInit = 16.0;
-static constexpr double zoomMin = 4.0;
+static constexpr double zoomMin = 0.05;
 static constexpr double zoomMax = 128.0;
 static constexpr double zoomAttenuation = 500.0;
 
@@ -18,7 +18,8 @@ View::View() :
   mutex(QMutex::Recursive),
   _viewportWidth(900),
   _viewportHeight(600),
-  _zoom(zoomInit) {}
+  _zoom(zoomInit),
+  _revision(0) {}
 
 double View::left() {
   QMutexLocker locker(&mutex);
@@ -44,6 +45,11 @@ double View::top() {
   return _focusPos.y() + halfZoomRec * _viewportHeight;
 }
 
+double View::zoom() {
+  QMutexLocker locker(&mutex);
+  return _zoom;
+}
+
 bool View::includes(const QPointF& headWorldPos) {
   QMutexLocker locker(&mutex);
   static constexpr double slack = 2.0;
@@ -53,21 +59,29 @@ bool View::includes(const QPointF& headWorldPos) {
          && (headWorldPos.y() <= top() + slack);
 }
 
+int View::revision() {
+  QMutexLocker locker(&mutex);
+  return _revision;
+}
+
 void View::setViewportSize(int viewportWidth, int viewportHeight) {
   QMutexLocker locker(&mutex);
   _viewportWidth = viewportWidth;
   _viewportHeight = viewportHeight;
+  ++_revision;
 }
 
 void View::setFocusPos(const QPointF& focusPos) {
   QMutexLocker locker(&mutex);
   _focusPos = focusPos;
+  ++_revision;
 }
 
 void View::modifyFocusPos(const QPointF& mouseOffset) {
   QMutexLocker locker(&mutex);
   QPointF scaledOffset = mouseOffset / _zoom;
   _focusPos = _focusPos + scaledOffset;
+  ++_revision;
 }
 
 void View::setZoom(double zoom) {
@@ -78,6 +92,7 @@ void View::setZoom(double zoom) {
   } else if (_zoom > zoomMax) {
     _zoom = zoomMax;
   }
+  ++_revision;
 }
 
 void View::modifyZoom(const QPointF& mousePos, double mouseAngleDelta) {
@@ -91,4 +106,5 @@ void View::modifyZoom(const QPointF& mousePos, double mouseAngleDelta) {
 
   // Move the focus point so that the point under the cursor remains unchanged.
   _focusPos = _focusPos + oldPos - newPos;
+  ++_revision;
 }
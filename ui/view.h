@@ -16,9 +16,13 @@ class View {
   double right();
   double bottom();
   double top();
+  double zoom();
 
   bool includes(const QPointF& headWorldPos);
 
+  // Returns a number that changes whenever the viewport, focus, or zoom do.
+  int revision();
+
   void setViewportSize(int viewportWidth, int viewportHeight);
   void setFocusPos(const QPointF& focusPos);
   void setZoom(double zoom);
@@ -32,6 +36,7 @@ class View {
   int _viewportWidth, _viewportHeight;
   QPointF _focusPos;
   double _zoom;
+  int _revision;
 };
 
 #endif  // AMOEBOTSIM_UI_VIEW_H_
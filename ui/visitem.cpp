@@ -4,13 +4,14 @@
 
 #include "ui/visitem.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QImage>
 #include <QMutexLocker>
 #include <QOpenGLFunctions_2_0>
 #include <QQuickWindow>
-#include <QRgb>
+#include <QRectF>
 
 // visualisation preferences
 static constexpr float targetFramesPerSecond = 60.0f;
@@ -18,44 +19,64 @@ static constexpr float targetFramesPerSecond = 60.0f;
 // values derived from the preferences above
 static constexpr float targetFrameDuration = 1000.0f / targetFramesPerSecond;
 
-// height of a triangle in our equilateral triangular grid if the side length is 1
-static const double triangleHeight = sqrt(3.0 / 4.0);
-
 VisItem::VisItem(QQuickItem* parent) :
   GLItem(parent),
+  cachedXMin(0),
+  cachedXMax(-1),
+  cachedYMin(0),
+  cachedYMax(-1),
+  systemGeneration(0),
+  renderedGeneration(-1),
+  densityGeneration(-1),
+  requestedSystem(nullptr),
+  requestedSystemRevision(0),
+  requestedViewRevision(-1),
   translating(false) {
   setAcceptedMouseButtons(Qt::LeftButton);
   renderTimer.start(targetFrameDuration);
 }
 
+QImage VisItem::grabFrame() {
+  return window()->grabWindow();
+}
+
 void VisItem::systemChanged(std::shared_ptr<System> _system) {
   system = _system;
+  ++systemGeneration;
 }
 
 void VisItem::focusOnCenterOfMass() {
-  QMutexLocker locker(&system->mutex);
-  if (system == nullptr || system->size() == 0) {
+  if (system == nullptr) {
     return;
   }
 
-  QPointF sum;
-  int numMassPoints = 0;
+  QMutexLocker locker(&system->mutex);
+  if (system->size() == 0 && system->numObjects() == 0) {
+    return;
+  }
+  view.setFocusPos(system->centerOfMass());
+}
 
-  for (const Particle& p : *system) {
-    sum = sum + nodeToWorldCoord(p.head);
-    numMassPoints++;
-    if (p.globalTailDir != -1) {
-      sum = sum + nodeToWorldCoord(p.tail());
-      numMassPoints++;
-    }
+void VisItem::zoomToFit() {
+  if (system == nullptr) {
+    return;
   }
 
-  for(const Object* obj: system->getObjects()) {
-      sum = sum + nodeToWorldCoord(obj->_node);
-      numMassPoints++;
+  QRectF box;
+  {
+    QMutexLocker locker(&system->mutex);
+    if (system->size() == 0 && system->numObjects() == 0) {
+      return;
+    }
+    box = system->boundingBox();
   }
 
-  view.setFocusPos(sum / numMassPoints);
+  // The bounding box is spanned by node centers; leave room for the sprites
+  // around them.
+  static constexpr double margin = 2.0;
+  box.adjust(-margin, -margin, margin, margin);
+  view.setFocusPos(box.center());
+  view.setZoom(std::min(width() / box.width(), height() / box.height()));
 }
 
 void VisItem::setWindowSize(int width, int height) {
@@ -72,7 +93,22 @@ void VisItem::setZoom(double zoom) {
 }
 
 void VisItem::saveScreenshot(QString filePath) {
-  window()->grabWindow().save(filePath);
+  grabFrame().save(filePath);
+}
+
+void VisItem::updateIfChanged() {
+  // Repainting is skipped entirely while neither the system nor the camera
+  // changed; the window keeps showing the last frame.
+  System* currentSystem = system.get();
+  const int systemRevision = (currentSystem != nullptr) ? currentSystem->revision() : 0;
+  const int viewRevision = view.revision();
+  if (currentSystem != requestedSystem || systemRevision != requestedSystemRevision
+      || viewRevision != requestedViewRevision) {
+    requestedSystem = currentSystem;
+    requestedSystemRevision = systemRevision;
+    requestedViewRevision = viewRevision;
+    window()->update();
+  }
 }
 
 void VisItem::initialize() {
@@ -87,8 +123,10 @@ void VisItem::initialize() {
   particleTex->bind();
   particleTex->generateMipMaps();
 
+  particleRenderer.initialize(glfn);
+
   Q_ASSERT(window() != nullptr);
-  connect(&renderTimer, &QTimer::timeout, window(), &QQuickWindow::update);
+  connect(&renderTimer, &QTimer::timeout, this, &VisItem::updateIfChanged);
 }
 
 void VisItem::paint() {
@@ -106,20 +144,21 @@ void VisItem::paint() {
 
   setupCamera();
 
-  drawGrid();
-
-  if (system != nullptr) {
-    QMutexLocker locker(&system->mutex);
-
+  if (view.zoom() >= detailZoomMin) {
+    drawGrid();
     drawParticles();
-
-    drawObjects();
+  } else {
+    // The heatmap does not cover the whole window like the grid does.
+    glfn->glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glfn->glClear(GL_COLOR_BUFFER_BIT);
+    drawDensity();
   }
 }
 
 void VisItem::deinitialize() {
   renderTimer.disconnect();
 
+  particleRenderer.deinitialize();
   particleTex = nullptr;
   gridTex = nullptr;
 }
@@ -138,7 +177,7 @@ void VisItem::setupCamera() {
 
 void VisItem::drawGrid() {
   // gridTex has the height of two triangles.
-  static const double gridTexHeight = 2.0 * triangleHeight;
+  static const double gridTexHeight = 2.0 * ParticleRenderer::triangleHeight;
 
   // Coordinate sytem voodoo:
   // Calculates the texture coordinates of the corners of the shown part of the grid.
@@ -163,125 +202,94 @@ void VisItem::drawGrid() {
 }
 
 void VisItem::drawParticles() {
-  particleTex->bind();
-  glfn->glBegin(GL_QUADS);
+  if (system != nullptr) {
+    QMutexLocker locker(&system->mutex);
 
-  // Draw particle marks, then particles, then borders, then border points.
-  for (const Particle& p : *system) {
-    if (view.includes(nodeToWorldCoord(p.head))) {
-      drawMarks(p);
-    }
-  }
-  for (const Particle& p : *system) {
-    if (view.includes(nodeToWorldCoord(p.head))) {
-      drawParticle(p);
-    }
-  }
-  for (const Particle& p : *system) {
-    if (view.includes(nodeToWorldCoord(p.head))) {
-      drawBorders(p);
+    // Objects are static, so they are only set when the system is replaced or
+    // objects are inserted.
+    if (renderedGeneration != systemGeneration
+        || system->numObjects() != particleRenderer.numObjects()) {
+      particleRenderer.setObjects(system->getObjects());
     }
-  }
-  for (const Particle& p : *system) {
-    if (view.includes(nodeToWorldCoord(p.head))) {
-      drawBorderPoints(p);
-    }
-  }
-
-  glfn->glEnd();
-}
-
-void VisItem::drawMarks(const Particle& p) {
-  // Draw head mark.
-  if (p.headMarkColor() != -1) {
-    auto pos = nodeToWorldCoord(p.head);
-    auto color = p.headMarkColor();
-    glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 180 << 23);
-    drawFromParticleTex(p.headMarkGlobalDir() + 8, pos);
-  }
-
-  // Draw tail mark.
-  if (p.globalTailDir != -1 && p.tailMarkColor() > -1) {
-    auto pos = nodeToWorldCoord(p.tail());
-    auto color = p.tailMarkColor();
-    glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 180 << 23);
-    drawFromParticleTex(p.tailMarkGlobalDir() + 8, pos);
-  }
-}
-
-void VisItem::drawParticle(const Particle& p) {
-  auto pos = nodeToWorldCoord(p.head);
-  glfn->glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-  drawFromParticleTex(p.globalTailDir + 1, pos);
-}
 
-void VisItem::drawBorders(const Particle& p) {
-  auto pos = nodeToWorldCoord(p.head);
-  for (unsigned int i = 0; i < p.borderColors().size(); ++i) {
-    if (p.borderColors().at(i) != -1) {
-      auto color = p.borderColors().at(i);
-      glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 180 << 23);
-      drawFromParticleTex(i + 21, pos);
+    // Only the particles in the cached range of lattice coordinates around the
+    // view have sprites. Rebuild them if the view left that range, the system
+    // was replaced, too much changed to be tracked, or a changed particle moved
+    // into the range; otherwise, only update the sprites of the changed
+    // particles.
+    const bool complete = system->takeChanges(changedParticles);
+    int xMin, xMax, yMin, yMax;
+    visibleLatticeRange(xMin, xMax, yMin, yMax);
+    bool rebuild = !complete || renderedGeneration != systemGeneration
+                   || xMin < cachedXMin || xMax > cachedXMax
+                   || yMin < cachedYMin || yMax > cachedYMax;
+    for (unsigned int i = 0; !rebuild && i < changedParticles.size(); ++i) {
+      const Particle* p = changedParticles[i];
+      rebuild = !particleRenderer.hasSlot(p)
+                && cachedXMin <= p->head.x && p->head.x <= cachedXMax
+                && cachedYMin <= p->head.y && p->head.y <= cachedYMax;
     }
-  }
-}
 
-void VisItem::drawBorderPoints(const Particle& p) {
-  auto pos = nodeToWorldCoord(p.head);
-  for (unsigned int i = 0; i < p.borderPointColors().size(); ++i) {
-    if (p.borderPointColors().at(i) != -1) {
-      auto color = p.borderPointColors().at(i);
-      glfn->glColor4i(qRed(color) << 23, qGreen(color) << 23, qBlue(color) << 23, 255 << 23);
-      drawFromParticleTex(i + 15, pos);
+    if (rebuild) {
+      // Cache half a view of slack in every direction, so that panning does
+      // not immediately require another rebuild.
+      const int xSlack = (xMax - xMin) / 2, ySlack = (yMax - yMin) / 2;
+      cachedXMin = xMin - xSlack;
+      cachedXMax = xMax + xSlack;
+      cachedYMin = yMin - ySlack;
+      cachedYMax = yMax + ySlack;
+      visibleParticles.clear();
+      system->particlesInRange(cachedXMin, cachedXMax, cachedYMin, cachedYMax,
+                               visibleParticles);
+      particleRenderer.rebuild(visibleParticles);
+      renderedGeneration = systemGeneration;
+    } else {
+      particleRenderer.update(changedParticles);
     }
+    densityGeneration = -1;
+  } else if (renderedGeneration != -1) {
+    particleRenderer.clear();
+    renderedGeneration = -1;
   }
-}
 
-void VisItem::drawFromParticleTex(int index, const QPointF& pos) {
-  // These values are a consequence of how the particle texture was created. The
-  // expression (90.0f / 96.0f) is done to handle the conversion between 90 dpi
-  // and 96 dpi that Inkscape does when exporting the particle.svg as a .png.
-  static constexpr int texSize = 8;
-  static constexpr double invTexSize = (90.0 / 96.0) / texSize;
-  static constexpr double halfQuadSideLength = 256.0 / 220.0;
-
-  const double column = index % texSize;
-  const double row = index / texSize;
-  const QPointF texOffset(invTexSize * column, invTexSize * row);
-
-  glfn->glTexCoord2d(texOffset.x(), texOffset.y());
-  glfn->glVertex2d(pos.x() - halfQuadSideLength, pos.y() - halfQuadSideLength);
-  glfn->glTexCoord2d(texOffset.x() + invTexSize, texOffset.y());
-  glfn->glVertex2d(pos.x() + halfQuadSideLength, pos.y() - halfQuadSideLength);
-  glfn->glTexCoord2d(texOffset.x() + invTexSize, texOffset.y() + invTexSize);
-  glfn->glVertex2d(pos.x() + halfQuadSideLength, pos.y() + halfQuadSideLength);
-  glfn->glTexCoord2d(texOffset.x(), texOffset.y() + invTexSize);
-  glfn->glVertex2d(pos.x() - halfQuadSideLength, pos.y() + halfQuadSideLength);
+  particleRenderer.draw(particleTex.get());
 }
 
-void VisItem::drawObjects() {
-  glfn->glBegin(GL_QUADS);
+void VisItem::drawDensity() {
+  if (system != nullptr) {
+    QMutexLocker locker(&system->mutex);
 
-  std::deque<Object*> objects = system->getObjects();
-  for(auto t : objects) {
-      drawObject(*t);
+    // The heatmap is maintained from the change journal like the particle
+    // sprites, which become stale while it is shown.
+    const bool complete = system->takeChanges(changedParticles);
+    if (!complete || densityGeneration != systemGeneration
+        || system->numObjects() != densityRenderer.numObjects()) {
+      densityRenderer.rebuild(*system);
+      densityGeneration = systemGeneration;
+    } else {
+      densityRenderer.update(changedParticles);
+    }
+    renderedGeneration = -1;
+  } else if (densityGeneration != -1) {
+    densityRenderer.clear();
+    densityGeneration = -1;
   }
 
-  glfn->glEnd();
+  densityRenderer.draw(glfn);
 }
 
-void VisItem::drawObject(const Object& t) {
-  auto pos = nodeToWorldCoord(t._node);
-  glfn->glColor4d(0.0, 0.0, 0.0, 1.0);
-  drawFromParticleTex(39, pos);
+void VisItem::visibleLatticeRange(int& xMin, int& xMax, int& yMin, int& yMax) {
+  ParticleRenderer::latticeRange(QRectF(QPointF(view.left(), view.bottom()),
+                                        QPointF(view.right(), view.top())),
+                                 xMin, xMax, yMin, yMax);
 }
 
 QPointF VisItem::nodeToWorldCoord(const Node& node) {
-  return QPointF(node.x + 0.5 * node.y, node.y * triangleHeight);
+  return ParticleRenderer::nodeToWorldCoord(node);
 }
 
 Node VisItem::worldCoordToNode(const QPointF& worldCord) {
-  const int y = std::round(worldCord.y() / triangleHeight);
+  const int y = std::round(worldCord.y() / ParticleRenderer::triangleHeight);
   const int x = std::round(worldCord.x() - 0.5 * y);
 
   return Node(x, y);
@@ -307,10 +315,11 @@ void VisItem::mousePressEvent(QMouseEvent* e) {
       translating = false;
       auto clickedNode = worldCoordToNode(windowCoordToWorldCoord(e->localPos()));
       QString text = "";
-      for (const auto& p : *system) {
-        if (p.head == clickedNode || (p.isExpanded() && p.tail() == clickedNode)) {
-          text = p.inspectionText();
-          break;
+      if (system != nullptr) {
+        QMutexLocker locker(&system->mutex);
+        const Particle* p = system->particleAt(clickedNode);
+        if (p != nullptr) {
+          text = p->inspectionText();
         }
       }
       while (text.endsWith('\n')) {
@@ -6,7 +6,9 @@
 #define AMOEBOTSIM_UI_VISITEM_H_
 
 #include <memory>
+#include <vector>
 
+#include <QImage>
 #include <QMouseEvent>
 #include <QOpenGLTexture>
 #include <QPointF>
@@ -18,7 +20,9 @@
 #include "core/object.h"
 #include "core/particle.h"
 #include "core/system.h"
+#include "ui/densityrenderer.h"
 #include "ui/glitem.h"
+#include "ui/particlerenderer.h"
 #include "ui/view.h"
 
 class VisItem : public GLItem {
@@ -27,6 +31,13 @@ class VisItem : public GLItem {
  public:
   explicit VisItem(QQuickItem* parent = nullptr);
 
+  // Renders the window and returns its contents.
+  QImage grabFrame();
+
+  // The zoom (in pixels per unit of length) below which particles are drawn as
+  // a density heatmap rather than individually.
+  static constexpr double detailZoomMin = 4.0;
+
  signals:
   void stepForParticleAt(Node node);
   void inspectParticle(QString text);
@@ -34,12 +45,14 @@ class VisItem : public GLItem {
  public slots:
   void systemChanged(std::shared_ptr<System> _system);
   void focusOnCenterOfMass();
+  void zoomToFit();
   void setWindowSize(int width, int height);
   void focusOn(Node node);
   void setZoom(double zoom);
   void saveScreenshot(QString filePath);
 
  protected slots:
+  void updateIfChanged();
   virtual void initialize();
   virtual void paint();
   virtual void deinitialize();
@@ -50,13 +63,8 @@ class VisItem : public GLItem {
 
   void drawGrid();
   void drawParticles();
-  void drawMarks(const Particle& p);
-  void drawParticle(const Particle& p);
-  void drawBorders(const Particle& p);
-  void drawBorderPoints(const Particle& p);
-  void drawFromParticleTex(int index, const QPointF& pos);
-  void drawObjects();
-  void drawObject(const Object& t);
+  void drawDensity();
+  void visibleLatticeRange(int& xMin, int& xMax, int& yMin, int& yMax);
 
   static QPointF nodeToWorldCoord(const Node& node);
   static Node worldCoordToNode(const QPointF& worldCord);
@@ -69,10 +77,24 @@ class VisItem : public GLItem {
  protected:
   std::unique_ptr<QOpenGLTexture> gridTex;
   std::unique_ptr<QOpenGLTexture> particleTex;
+  ParticleRenderer particleRenderer;
+  std::vector<const Particle*> changedParticles;
+  std::vector<const Particle*> visibleParticles;
+  int cachedXMin, cachedXMax, cachedYMin, cachedYMax;
+  DensityRenderer densityRenderer;
+
+  // The number of systems set so far, and the one the particle sprites and the
+  // heatmap were built from (-1 if they are empty). Unlike pointers, these
+  // differ even if a new system is allocated where a deleted one was.
+  int systemGeneration;
+  int renderedGeneration;
+  int densityGeneration;
 
   QTimer renderTimer;
 
   View view;
+  System* requestedSystem;
+  int requestedSystemRevision, requestedViewRevision;
   QPointF lastMousePos;
   bool translating;
 